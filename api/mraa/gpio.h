@@ -55,6 +55,66 @@ extern "C" {
  */
 typedef struct _gpio* mraa_gpio_context;
 
+/**
+ * Opaque pointer definition to the internal struct _gpio_group
+ */
+typedef struct _gpio_group* mraa_gpio_group_context;
+
+/**
+ * Maximum number of pins in a gpio group, one bit of a group value each
+ */
+#define MRAA_GPIO_GROUP_MAX_PINS 32
+
+/**
+ * A timestamped edge captured by mraa_gpio_events()
+ */
+typedef struct {
+    unsigned long long timestamp; /**< nanoseconds, kernel event time on gpiochip contexts, CLOCK_MONOTONIC otherwise */
+    int value; /**< level after the edge, 1 for rising and 0 for falling */
+} mraa_gpio_event_t;
+
+/**
+ * One step of a waveform played with mraa_gpio_group_wave(). The pins in mask
+ * take the matching bits of value in a single register write, then the
+ * output is held for delay_ns before the next step.
+ */
+typedef struct {
+    unsigned int bank; /**< gpio bank, raw pin number / 32 */
+    uint32_t mask; /**< pins of the bank to change */
+    uint32_t value; /**< new level of the pins in mask */
+    uint32_t delay_ns; /**< time to hold this step in nanoseconds */
+} mraa_gpio_wave_step_t;
+
+/**
+ * Measurements taken by mraa_gpio_capture_start()
+ */
+typedef enum {
+    MRAA_CAPTURE_PERIOD = 1, /**< Period and frequency, from rising edge to rising edge */
+    MRAA_CAPTURE_WIDTH = 2   /**< High and low pulse widths */
+} mraa_gpio_capture_t;
+
+/**
+ * Statistics over the rolling window of a capture. Means are 0 until at
+ * least one matching measurement has been taken.
+ */
+typedef struct {
+    unsigned int periods; /**< periods in the window */
+    unsigned long long period_ns; /**< mean period */
+    unsigned long long period_min_ns; /**< shortest period */
+    unsigned long long period_max_ns; /**< longest period */
+    double frequency; /**< 1 / mean period in Hz */
+    unsigned int widths; /**< high pulses in the window */
+    unsigned long long high_ns; /**< mean high width */
+    unsigned long long low_ns; /**< mean low width */
+    double duty; /**< mean high width / (high + low), 0.0 to 1.0 */
+    unsigned long long last_edge_ns; /**< timestamp of the latest edge, to spot a stopped signal */
+} mraa_gpio_capture_stats_t;
+
+/**
+ * Opaque pointer definition to the internal struct _gpio_vcd
+ */
+typedef struct _gpio_vcd* mraa_gpio_vcd_context;
+
 /**
  * Gpio Output modes
  */
@@ -101,6 +161,26 @@ mraa_gpio_context mraa_gpio_init(int pin);
  */
 mraa_gpio_context mraa_gpio_init_raw(int gpiopin);
 
+/**
+ * Initialise gpio_context, based on board number, using the gpiochip
+ * character device (/dev/gpiochipN) instead of sysfs. The pin is not
+ * exported, reads and writes are a single ioctl on a line handle and
+ * interrupts are delivered as line events. Requires a 4.8+ kernel.
+ *
+ *  @param pin Pin number read from the board, i.e IO3 is 3
+ *  @returns gpio context or NULL
+ */
+mraa_gpio_context mraa_gpio_init_chardev(int pin);
+
+/**
+ * Initialise gpio context using the gpiochip character device without any
+ * mapping to a pin
+ *
+ * @param gpiopin gpio pin as listed in SYSFS
+ * @return gpio context or NULL
+ */
+mraa_gpio_context mraa_gpio_init_chardev_raw(int gpiopin);
+
 /**
  * Set the edge mode on the gpio
  *
@@ -131,6 +211,111 @@ mraa_result_t mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t edge, void (
  */
 mraa_result_t mraa_gpio_isr_exit(mraa_gpio_context dev);
 
+/**
+ * Block the calling thread until an edge set with mraa_gpio_edge_mode()
+ * occurs, without creating a thread. Cannot be used whilst an isr is set on
+ * the context.
+ *
+ * @param dev The Gpio context
+ * @param timeout_ms Maximum time to wait in milliseconds, -1 waits forever
+ * @return The level of the Gpio after the edge, -1 on error or -2 on timeout
+ */
+int mraa_gpio_wait_edge(mraa_gpio_context dev, int timeout_ms);
+
+/**
+ * Measure an input signal from timestamped edges. Edges are processed by the
+ * interupt dispatcher as they arrive, so the application only fetches the
+ * aggregated result with mraa_gpio_capture_read(). Stop with
+ * mraa_gpio_isr_exit().
+ *
+ * @param dev The Gpio context
+ * @param flags MRAA_CAPTURE_PERIOD and/or MRAA_CAPTURE_WIDTH
+ * @param window Number of most recent measurements the statistics cover,
+ *  0 for the default of 16
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_capture_start(mraa_gpio_context dev, int flags, unsigned int window);
+
+/**
+ * Get the statistics of a capture over its rolling window
+ *
+ * @param dev The Gpio context
+ * @param stats Filled with the statistics
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_capture_read(mraa_gpio_context dev, mraa_gpio_capture_stats_t* stats);
+
+/**
+ * Set the priority of the interupt on this Gpio. Interupts are serviced by a
+ * shared pool of dispatcher threads, when several are pending at once the
+ * highest priority ones are serviced first. The default priority is 0.
+ *
+ * @param dev The Gpio context
+ * @param priority Priority of the interupt, higher is serviced first
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_isr_priority(mraa_gpio_context dev, int priority);
+
+/**
+ * Set the number of dispatcher threads servicing Gpio interupts. Takes
+ * effect the next time the dispatcher starts, that is when the first isr is
+ * set after all isrs have exited. The default is a single thread.
+ *
+ * @param num_threads Number of threads, 1 to 8
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_isr_threads(unsigned int num_threads);
+
+/**
+ * Service the interupt on this Gpio by busy polling the SoC data registers
+ * instead of waiting on sysfs, for edges sysfs is too slow to follow. Edges
+ * are found by comparing samples, so a pulse shorter than one pass of the
+ * polling loop can be missed. A single polling thread serves every Gpio in
+ * this mode and samples each bank once per pass, it keeps a cpu busy while
+ * any isr is set. Must be called before mraa_gpio_isr(). Only supported on
+ * platforms with the registers mapped, currently the LinkIt Smart 7688.
+ *
+ * @param dev The Gpio context
+ * @param cpu Cpu the shared polling thread is pinned to, applied straight
+ *  away and replacing any earlier choice, -1 to leave it as it is
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_isr_poll(mraa_gpio_context dev, int cpu);
+
+/**
+ * Capture edges into a queue instead of calling an isr. Every edge is
+ * timestamped when it is received and kept until read back with
+ * mraa_gpio_read_events(), so edges arriving whilst the application is busy
+ * are not lost unless the queue fills up. Stop capturing with
+ * mraa_gpio_isr_exit(), which discards any unread events.
+ *
+ * @param dev The Gpio context
+ * @param edge The edge mode to capture
+ * @param queue_size Number of events the queue holds, rounded up to a power
+ *  of two, 0 for the default of 256, at most 2^20
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_events(mraa_gpio_context dev, mraa_gpio_edge_t edge, unsigned int queue_size);
+
+/**
+ * Read captured edges, oldest first. Does not block. Must not be called from
+ * more than one thread at a time for the same context.
+ *
+ * @param dev The Gpio context
+ * @param buf Buffer filled with events
+ * @param max Size of buf in events
+ * @return Number of events read or -1 on error
+ */
+int mraa_gpio_read_events(mraa_gpio_context dev, mraa_gpio_event_t* buf, int max);
+
+/**
+ * Get the number of edges dropped because the event queue was full
+ *
+ * @param dev The Gpio context
+ * @return Number of dropped events since mraa_gpio_events()
+ */
+unsigned int mraa_gpio_events_dropped(mraa_gpio_context dev);
+
 /**
  * Set Gpio Output Mode,
  *
@@ -210,6 +395,145 @@ int mraa_gpio_get_pin(mraa_gpio_context dev);
  */
 int mraa_gpio_get_pin_raw(mraa_gpio_context dev);
 
+/**
+ * Initialise a group of gpios, based on board numbers, that are read and
+ * written together. Bit n of a group value is pins[n]. On platforms with
+ * memory mapped gpio all pins in the same 32 bit bank are updated by one
+ * write to the bank SET register and one to the CLEAR register, otherwise
+ * the pins are written one after the other.
+ *
+ * @param pins Pin numbers read from the board
+ * @param num_pins Number of pins, at most MRAA_GPIO_GROUP_MAX_PINS
+ * @return gpio group context or NULL
+ */
+mraa_gpio_group_context mraa_gpio_group_init(const int* pins, int num_pins);
+
+/**
+ * Initialise a group of gpios using the gpiochip character device. All pins
+ * on the same gpiochip share one line handle so they are read or written
+ * with a single ioctl per chip.
+ *
+ * @param pins Pin numbers read from the board
+ * @param num_pins Number of pins, at most MRAA_GPIO_GROUP_MAX_PINS
+ * @return gpio group context or NULL
+ */
+mraa_gpio_group_context mraa_gpio_group_init_chardev(const int* pins, int num_pins);
+
+/**
+ * Set the direction of every pin in the group
+ *
+ * @param dev The Gpio group context
+ * @param dir The direction of the Gpios
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_dir(mraa_gpio_group_context dev, mraa_gpio_dir_t dir);
+
+/**
+ * Read every pin in the group
+ *
+ * @param dev The Gpio group context
+ * @param value Filled with the pin levels, bit n is pin n of the group
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_read(mraa_gpio_group_context dev, uint32_t* value);
+
+/**
+ * Write every pin in the group
+ *
+ * @param dev The Gpio group context
+ * @param value Pin levels, bit n is pin n of the group
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_write(mraa_gpio_group_context dev, uint32_t value);
+
+/**
+ * Close the Gpio group context and every Gpio in it
+ *
+ * @param dev The Gpio group context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_close(mraa_gpio_group_context dev);
+
+/**
+ * Fill in a waveform step from group values. All pins selected by mask must
+ * be in the same gpio bank.
+ *
+ * @param dev The Gpio group context
+ * @param mask Group pins to change, bit n is pin n of the group
+ * @param value New level of the pins, bit n is pin n of the group
+ * @param delay_ns Time to hold the step in nanoseconds
+ * @param step The step to fill in
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_wave_step(mraa_gpio_group_context dev, uint32_t mask, uint32_t value, uint32_t delay_ns, mraa_gpio_wave_step_t* step);
+
+/**
+ * Play a precomputed waveform on a group through the memory mapped gpio
+ * registers, timing each step with a calibrated busy wait. Blocks until the
+ * last step has been held. Every pin of the group must be an output and the
+ * platform must support mmap bank access. Only pins of the group can be
+ * changed by the waveform.
+ *
+ * @param dev The Gpio group context
+ * @param steps The waveform
+ * @param num_steps Number of steps
+ * @param realtime Run the calling thread at the highest SCHED_FIFO priority
+ *  whilst playing, so that it is not preempted by other processes
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_group_wave(mraa_gpio_group_context dev, const mraa_gpio_wave_step_t* steps, unsigned int num_steps, mraa_boolean_t realtime);
+
+/**
+ * Sample the whole gpio bank holding a pin as fast as possible, like a logic
+ * analyser. Every sample is one read of the bank input register, the pins
+ * are not reconfigured. The time is taken once per chunk of samples rather
+ * than per sample, timestamps must hold num_samples / chunk_size rounded up
+ * plus one entries, the last being the time sampling finished. The bank is
+ * mapped for the duration of the call, the pin itself need not use mmap.
+ *
+ * @param dev A Gpio context on the bank
+ * @param samples Filled with num_samples raw bank values, bit n is raw gpio bank * 32 + n
+ * @param num_samples Number of samples to take
+ * @param chunk_size Samples per timestamp
+ * @param timestamps Filled with CLOCK_MONOTONIC nanoseconds at the start of each chunk
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_sample_bank(mraa_gpio_context dev, uint32_t* samples, unsigned int num_samples, unsigned int chunk_size, unsigned long long* timestamps);
+
+/**
+ * Create a Value Change Dump file for samples of a gpio bank, viewable with
+ * tools such as GTKWave. Each pin in mask becomes a signal named after its
+ * raw gpio number.
+ *
+ * @param path File to create
+ * @param bank Gpio bank the samples come from, raw gpio number / 32
+ * @param mask Pins of the bank to record
+ * @return vcd context or NULL
+ */
+mraa_gpio_vcd_context mraa_gpio_vcd_open(const char* path, unsigned int bank, uint32_t mask);
+
+/**
+ * Append samples from mraa_gpio_sample_bank() to a vcd file. Only samples
+ * where a recorded pin changed are written, with a time interpolated within
+ * their chunk. Can be called repeatedly to stream consecutive captures.
+ *
+ * @param vcd The vcd context
+ * @param samples Raw bank values
+ * @param num_samples Number of samples
+ * @param chunk_size Samples per timestamp, as passed to mraa_gpio_sample_bank()
+ * @param timestamps Chunk timestamps from mraa_gpio_sample_bank()
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_vcd_write(mraa_gpio_vcd_context vcd, const uint32_t* samples, unsigned int num_samples, unsigned int chunk_size, const unsigned long long* timestamps);
+
+/**
+ * Flush and close a vcd file
+ *
+ * @param vcd The vcd context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_vcd_close(mraa_gpio_vcd_context vcd);
+
 #ifdef __cplusplus
 }
 #endif
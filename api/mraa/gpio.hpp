@@ -114,10 +114,14 @@ class Gpio
      * @param raw (optional) Raw pins will use gpiolibs pin numbering from
      * the kernel module. Note that you will not get any muxers set up for
      * you so this may not always work as expected.
+     * @param chardev (optional) Use the gpiochip character device instead
+     * of sysfs, owner is meaningless in this case as nothing is exported
      */
-    Gpio(int pin, bool owner = true, bool raw = false)
+    Gpio(int pin, bool owner = true, bool raw = false, bool chardev = false)
     {
-        if (raw) {
+        if (chardev) {
+            m_gpio = raw ? mraa_gpio_init_chardev_raw(pin) : mraa_gpio_init_chardev(pin);
+        } else if (raw) {
             m_gpio = mraa_gpio_init_raw(pin);
         } else {
             m_gpio = mraa_gpio_init(pin);
@@ -237,6 +241,41 @@ class Gpio
 #endif
         return (Result) mraa_gpio_isr_exit(m_gpio);
     }
+    /**
+     * Block until an edge set with edge() occurs, without creating a thread
+     *
+     * @param timeoutMs Maximum time to wait in milliseconds, -1 waits forever
+     * @return Gpio level after the edge, -1 on error or -2 on timeout
+     */
+    int
+    waitEdge(int timeoutMs = -1)
+    {
+        return mraa_gpio_wait_edge(m_gpio, timeoutMs);
+    }
+    /**
+     * Set the priority of the interupt, when several interupts are pending
+     * at once the highest priority ones are serviced first
+     *
+     * @param priority Priority of the interupt, higher is serviced first
+     * @return Result of operation
+     */
+    Result
+    isrPriority(int priority)
+    {
+        return (Result) mraa_gpio_isr_priority(m_gpio, priority);
+    }
+    /**
+     * Service the interupt by busy polling the SoC edge status registers
+     * instead of sysfs, call before isr(). Not supported on all platforms
+     *
+     * @param cpu Cpu the polling thread is pinned to, -1 for any
+     * @return Result of operation
+     */
+    Result
+    isrPoll(int cpu = -1)
+    {
+        return (Result) mraa_gpio_isr_poll(m_gpio, cpu);
+    }
     /**
      * Change Gpio mode
      *
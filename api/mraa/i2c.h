@@ -47,11 +47,119 @@ extern "C" {
 #include "common.h"
 #include "gpio.h"
 
+/**
+ * Size of the address bitmap filled by mraa_i2c_scan(), bit (addr % 8) of
+ * byte (addr / 8) is set when the 7 bit address answered
+ */
+#define MRAA_I2C_SCAN_BYTES 16
+
 /**
  * Opaque pointer definition to the internal struct _i2c
  */
 typedef struct _i2c* mraa_i2c_context;
 
+/**
+ * Opaque pointer definition to the internal struct _i2c_regmap
+ */
+typedef struct _i2c_regmap* mraa_i2c_regmap_context;
+
+/**
+ * Properties of a range of registers in a register map
+ */
+typedef enum {
+    MRAA_I2C_REG_CACHED = 0x0,    /**< Plain register, cached and written back on sync */
+    MRAA_I2C_REG_VOLATILE = 0x1,  /**< Changes on its own, always accessed on the bus */
+    MRAA_I2C_REG_READ_ONLY = 0x2  /**< Writes are refused */
+} mraa_i2c_reg_flags_t;
+
+/**
+ * A range of registers sharing the same mraa_i2c_reg_flags_t
+ */
+typedef struct {
+    /*@{*/
+    uint8_t first; /**< first register of the range */
+    uint8_t last; /**< last register of the range, inclusive */
+    unsigned int flags; /**< or of mraa_i2c_reg_flags_t */
+    /*@}*/
+} mraa_i2c_reg_range_t;
+
+/**
+ * Encoding of a value spread over consecutive registers
+ */
+typedef enum {
+    MRAA_I2C_FIELD_UNSIGNED = 0x0,      /**< Unsigned integer */
+    MRAA_I2C_FIELD_SIGNED = 0x1,        /**< Two's complement integer */
+    MRAA_I2C_FIELD_BIG_ENDIAN = 0x0,    /**< Most significant byte in the lowest register */
+    MRAA_I2C_FIELD_LITTLE_ENDIAN = 0x2, /**< Least significant byte in the lowest register */
+    MRAA_I2C_FIELD_FLOAT = 0x4          /**< Struct member is a float holding value * scale */
+} mraa_i2c_field_flags_t;
+
+/**
+ * Where a value lives in the registers of a slave and where it goes once
+ * decoded, see mraa_i2c_read_fields()
+ */
+typedef struct {
+    /*@{*/
+    uint8_t reg; /**< register holding the first byte */
+    uint8_t width; /**< size in bytes, 1 to 4 */
+    uint16_t flags; /**< or of mraa_i2c_field_flags_t */
+    float scale; /**< multiplier for float output, 0 is taken as 1 */
+    size_t offset; /**< offsetof() the member in the output struct */
+    /*@}*/
+} mraa_i2c_field_t;
+
+/**
+ * Direction of a message in an i2c transfer
+ */
+typedef enum {
+    MRAA_I2C_MSG_WRITE = 0x0000, /**< Write buf to the slave */
+    MRAA_I2C_MSG_READ = 0x0001   /**< Read from the slave into buf */
+} mraa_i2c_msg_flags_t;
+
+/**
+ * One segment of a combined i2c transfer, see mraa_i2c_transfer()
+ */
+typedef struct {
+    /*@{*/
+    uint16_t addr; /**< 7 bit slave address, independent of mraa_i2c_address() */
+    uint16_t flags; /**< mraa_i2c_msg_flags_t */
+    uint16_t len; /**< bytes to read or write */
+    uint8_t* buf; /**< data to write or buffer to read into */
+    /*@}*/
+} mraa_i2c_msg_t;
+
+/**
+ * A queued transaction, see mraa_i2c_submit()
+ */
+typedef struct _i2c_transaction mraa_i2c_transaction_t;
+
+/**
+ * Completion callback of a queued transaction, called from the bus worker
+ * thread once result is set and before complete is. The transaction may be
+ * resubmitted on the same bus from the callback but not freed or reused
+ * otherwise.
+ */
+typedef void (*mraa_i2c_callback_t)(mraa_i2c_transaction_t* transaction, void* args);
+
+/**
+ * A chain of messages run on the bus worker thread. The caller owns the
+ * struct and the message buffers, neither may be touched until the
+ * transaction is complete.
+ */
+struct _i2c_transaction {
+    /*@{*/
+    mraa_i2c_msg_t* msgs; /**< messages run as one mraa_i2c_transfer() */
+    int count; /**< number of messages */
+    int priority; /**< higher runs first, equal priorities run in submission order */
+    mraa_result_t result; /**< outcome, valid once complete is set */
+    volatile int complete; /**< set by the worker once the transfer is done and the callback returned */
+    mraa_i2c_context dev; /**< private, submitting context */
+    mraa_i2c_callback_t callback; /**< private */
+    void* args; /**< private */
+    mraa_i2c_transaction_t* next; /**< private, queue link */
+    /*@}*/
+};
+
 /**
  * Initialise i2c context, using board defintions
  *
@@ -126,9 +234,85 @@ uint16_t mraa_i2c_read_word_data(mraa_i2c_context dev, const uint8_t command);
  */
 int mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length);
 
+/**
+ * Read every field of a descriptor table with one mraa_i2c_read_bytes_data()
+ * burst covering the lowest to the highest register used, then decode each
+ * into the member of out at its offset. Integer members are int8_t/uint8_t,
+ * int16_t/uint16_t or int32_t/uint32_t (also for 3 byte fields) following
+ * width and signedness, MRAA_I2C_FIELD_FLOAT members are float. The slave
+ * must auto increment the register address during a read.
+ *
+ * @param dev The i2c context
+ * @param fields descriptor table
+ * @param count number of fields
+ * @param out struct the offsets refer to
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_read_fields(mraa_i2c_context dev, const mraa_i2c_field_t* fields, int count, void* out);
+
+/**
+ * Like mraa_i2c_read_fields() but store field i, multiplied by its scale, in
+ * values[i]. The offsets of the table are ignored.
+ *
+ * @param dev The i2c context
+ * @param fields descriptor table
+ * @param count number of fields
+ * @param values array of count floats
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_read_fields_float(mraa_i2c_context dev, const mraa_i2c_field_t* fields, int count, float* values);
+
+/**
+ * Run a chain of read and write messages as a single combined transfer.
+ * Messages are separated by repeated starts with one stop at the end, and
+ * each may address a different slave. The whole chain is one I2C_RDWR
+ * ioctl, so polling several devices costs one syscall.
+ *
+ * @param dev The i2c context
+ * @param msgs messages to run in order
+ * @param count number of messages, at most 42
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_transfer(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int count);
+
+/**
+ * Queue a transaction on the worker thread of the bus and return at once.
+ * One worker per bus runs the transactions of every context on that bus one
+ * after the other, highest priority first. Messages carry their own slave
+ * address so queued work never depends on mraa_i2c_address().
+ *
+ * @param dev The i2c context
+ * @param transaction msgs, count and priority filled in by the caller
+ * @param callback called on the worker thread when done, may be NULL
+ * @param args passed to callback
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_submit(mraa_i2c_context dev, mraa_i2c_transaction_t* transaction, mraa_i2c_callback_t callback, void* args);
+
+/**
+ * Block until a submitted transaction is complete, which includes its
+ * callback having returned
+ *
+ * @param transaction a transaction passed to mraa_i2c_submit()
+ * @return result of the transaction
+ */
+mraa_result_t mraa_i2c_wait(mraa_i2c_transaction_t* transaction);
+
+/**
+ * Block until every transaction submitted with this context is complete and
+ * its callback has returned. mraa_i2c_stop() does the same.
+ *
+ * @param dev The i2c context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_drain(mraa_i2c_context dev);
+
 /**
  * Write length bytes to the bus, the first byte in the array is the
- * command/register to write
+ * command/register to write. Up to 32 data bytes go out as one smbus block
+ * write. Longer buffers are split into messages no larger than the max
+ * transfer size, each one starting with the same first byte unless
+ * mraa_i2c_set_auto_increment() is enabled.
  *
  * @param dev The i2c context
  * @param data pointer to the byte array to be written
@@ -137,6 +321,45 @@ int mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* dat
  */
 mraa_result_t mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length);
 
+/**
+ * Limit the size of a single message sent by mraa_i2c_write() and
+ * mraa_i2c_write_eeprom(), for devices or adapters with small buffers
+ *
+ * @param dev The i2c context
+ * @param max bytes per message, address included, or 0 for the i2c-dev limit of 8192
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_set_max_transfer(mraa_i2c_context dev, int max);
+
+/**
+ * Make the pieces of a split mraa_i2c_write() start at the register where
+ * the previous piece stopped, for devices that auto-increment their
+ * register pointer. Off by default, as the first byte is often a control
+ * byte rather than a register. While enabled, a split write that would run
+ * past register 0xff is refused.
+ *
+ * @param dev The i2c context
+ * @param enable 1 to advance the register between pieces, 0 to repeat it
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_set_auto_increment(mraa_i2c_context dev, mraa_boolean_t enable);
+
+/**
+ * Write to a 24Cxx style eeprom at the context address. Data is split so
+ * that no message crosses a page boundary, and each page write waits for
+ * the device to ack again before the next one. Address bits that don't fit
+ * in addr_bytes go in the low bits of the slave address, as on the 24C16.
+ *
+ * @param dev The i2c context
+ * @param offset memory address of the first byte
+ * @param addr_bytes size of the memory address, 1 up to 24C16 and 2 above
+ * @param page_size write page of the part, 8 to 256 bytes
+ * @param data bytes to write
+ * @param length number of bytes
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_write_eeprom(mraa_i2c_context dev, unsigned int offset, int addr_bytes, int page_size, const uint8_t* data, int length);
+
 /**
  * Write a single byte to an i2c context, always at offset 0x0
  *
@@ -177,6 +400,118 @@ mraa_result_t mraa_i2c_write_word_data(mraa_i2c_context dev, const uint16_t data
  */
 mraa_result_t mraa_i2c_address(mraa_i2c_context dev, uint8_t address);
 
+/**
+ * Describe the registers of a slave so that they can be cached. Registers
+ * are 8 bit addresses holding val_bytes wide values, sent most significant
+ * byte first, and the device is expected to auto increment its register
+ * pointer on bursts. Registers not covered by ranges are plain cached ones.
+ * The i2c context must outlive the map; the map talks to address without
+ * changing the address set on the context.
+ *
+ * @param i2c The i2c context of the bus
+ * @param address slave address of the device
+ * @param val_bytes register width, 1 or 2 bytes
+ * @param num_regs registers 0 to num_regs - 1 exist, at most 256
+ * @param ranges volatile and read only ranges, may be NULL
+ * @param num_ranges entries in ranges
+ * @return register map context or NULL
+ */
+mraa_i2c_regmap_context mraa_i2c_regmap_init(mraa_i2c_context i2c, uint8_t address, int val_bytes, int num_regs, const mraa_i2c_reg_range_t* ranges, int num_ranges);
+
+/**
+ * Read a register, from the cache when it holds a valid copy
+ *
+ * @param map The register map context
+ * @param reg register to read
+ * @param value filled with the register value
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_read(mraa_i2c_regmap_context map, uint8_t reg, unsigned int* value);
+
+/**
+ * Write a register. Cached registers are only updated in memory and marked
+ * dirty until mraa_i2c_regmap_sync(), volatile ones are written at once.
+ *
+ * @param map The register map context
+ * @param reg register to write
+ * @param value new value
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_write(mraa_i2c_regmap_context map, uint8_t reg, unsigned int value);
+
+/**
+ * Read-modify-write the bits of a register selected by mask. For a cached
+ * register this costs no bus traffic once the value is known, and nothing
+ * is marked dirty when the bits already hold value.
+ *
+ * @param map The register map context
+ * @param reg register to update
+ * @param mask bits to change
+ * @param value new value of the bits in mask
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_update_bits(mraa_i2c_regmap_context map, uint8_t reg, unsigned int mask, unsigned int value);
+
+/**
+ * Write every dirty register to the device. Runs of consecutive dirty
+ * registers become one burst each and all bursts go out as one combined
+ * transfer where the adapter allows it.
+ *
+ * @param map The register map context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_sync(mraa_i2c_regmap_context map);
+
+/**
+ * Forget every cached value, for instance after the device was reset.
+ * Dirty registers are dropped without being written.
+ *
+ * @param map The register map context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_invalidate(mraa_i2c_regmap_context map);
+
+/**
+ * Free a register map, dirty registers are not written
+ *
+ * @param map The register map context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_stop(mraa_i2c_regmap_context map);
+
+/**
+ * Find the slaves present on a bus, like i2cdetect. Addresses 0x03 to 0x77
+ * are probed with a quick write where the adapter supports it and with a one
+ * byte read otherwise, always reading in the eeprom ranges 0x30-0x37 and
+ * 0x50-0x5f. The result is cached, later calls return it without touching
+ * the bus until mraa_i2c_scan_invalidate().
+ *
+ * @param bus bus number as for mraa_i2c_init()
+ * @param bitmap MRAA_I2C_SCAN_BYTES bytes receiving the answering addresses
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_scan(int bus, uint8_t* bitmap);
+
+/**
+ * mraa_i2c_scan() several buses at once, the buses that are not cached yet
+ * are probed concurrently, one thread each
+ *
+ * @param buses bus numbers as for mraa_i2c_init()
+ * @param count number of buses
+ * @param bitmaps count * MRAA_I2C_SCAN_BYTES bytes, the bitmap of buses[i]
+ * starting at bitmaps + i * MRAA_I2C_SCAN_BYTES
+ * @return Result of operation, the first failure if several buses failed
+ */
+mraa_result_t mraa_i2c_scan_buses(const int* buses, int count, uint8_t* bitmaps);
+
+/**
+ * Drop the cached scan of a bus, for instance after hotplugging a device
+ *
+ * @param bus bus number as for mraa_i2c_init(), -1 for every bus
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_scan_invalidate(int bus);
+
 /**
  * De-inits an mraa_i2c_context device
  *
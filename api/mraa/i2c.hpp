@@ -163,6 +163,87 @@ class I2c
         return mraa_i2c_read_bytes_data(m_i2c, reg, data, length);
     }
 
+    /**
+     * Read a descriptor table of registers in one burst and decode each
+     * field into the member of out at its offset
+     *
+     * @param fields descriptor table
+     * @param count number of fields
+     * @param out struct the offsets refer to
+     * @return Result of operation
+     */
+    Result
+    readFields(const mraa_i2c_field_t* fields, int count, void* out)
+    {
+        return (Result) mraa_i2c_read_fields(m_i2c, fields, count, out);
+    }
+
+    /**
+     * Read a descriptor table of registers in one burst and store each
+     * scaled field in values
+     *
+     * @param fields descriptor table
+     * @param count number of fields
+     * @param values array of count floats
+     * @return Result of operation
+     */
+    Result
+    readFieldsFloat(const mraa_i2c_field_t* fields, int count, float* values)
+    {
+        return (Result) mraa_i2c_read_fields_float(m_i2c, fields, count, values);
+    }
+
+    /**
+     * Run a chain of read and write messages, possibly to several slaves,
+     * as one combined transfer with repeated starts
+     *
+     * @param msgs messages to run in order
+     * @param count number of messages
+     * @return Result of operation
+     */
+    Result
+    transfer(mraa_i2c_msg_t* msgs, int count)
+    {
+        return (Result) mraa_i2c_transfer(m_i2c, msgs, count);
+    }
+
+    /**
+     * Queue a transaction on the bus worker thread and return at once
+     *
+     * @param transaction msgs, count and priority filled in by the caller
+     * @param callback called on the worker thread when done, may be NULL
+     * @param args passed to callback
+     * @return Result of operation
+     */
+    Result
+    submit(mraa_i2c_transaction_t* transaction, mraa_i2c_callback_t callback = NULL, void* args = NULL)
+    {
+        return (Result) mraa_i2c_submit(m_i2c, transaction, callback, args);
+    }
+
+    /**
+     * Block until a submitted transaction is complete
+     *
+     * @param transaction a submitted transaction
+     * @return result of the transaction
+     */
+    Result
+    wait(mraa_i2c_transaction_t* transaction)
+    {
+        return (Result) mraa_i2c_wait(transaction);
+    }
+
+    /**
+     * Block until every transaction submitted on this context is complete
+     *
+     * @return Result of operation
+     */
+    Result
+    drain()
+    {
+        return (Result) mraa_i2c_drain(m_i2c);
+    }
+
     /**
      * Write a byte on the bus
      *
@@ -189,6 +270,47 @@ class I2c
         return (Result) mraa_i2c_write(m_i2c, data, length);
     }
 
+    /**
+     * Limit the size of a single message sent by write() and writeEeprom()
+     *
+     * @param max bytes per message or 0 for the i2c-dev limit
+     * @return Result of operation
+     */
+    Result
+    setMaxTransfer(int max)
+    {
+        return (Result) mraa_i2c_set_max_transfer(m_i2c, max);
+    }
+
+    /**
+     * Make the pieces of a split write() continue at the register where
+     * the previous one stopped instead of repeating the first byte
+     *
+     * @param enable true to advance the register between pieces
+     * @return Result of operation
+     */
+    Result
+    setAutoIncrement(bool enable)
+    {
+        return (Result) mraa_i2c_set_auto_increment(m_i2c, enable);
+    }
+
+    /**
+     * Write to a 24Cxx eeprom page by page, waiting for each write cycle
+     *
+     * @param offset memory address of the first byte
+     * @param addrBytes size of the memory address, 1 or 2
+     * @param pageSize write page of the part
+     * @param data bytes to write
+     * @param length number of bytes
+     * @return Result of operation
+     */
+    Result
+    writeEeprom(unsigned int offset, int addrBytes, int pageSize, const uint8_t* data, int length)
+    {
+        return (Result) mraa_i2c_write_eeprom(m_i2c, offset, addrBytes, pageSize, data, length);
+    }
+
     /**
      * Write a byte to an i2c register
      *
@@ -47,6 +47,16 @@ extern "C" {
 
 typedef struct _pwm* mraa_pwm_context;
 
+/**
+ * Timing statistics of a software pwm channel. Jitter is how late each edge
+ * was driven compared to when it was scheduled.
+ */
+typedef struct {
+    unsigned long long edges; /**< edges driven since the channel was enabled */
+    unsigned int mean_jitter_ns; /**< mean lateness of an edge in ns */
+    unsigned int max_jitter_ns; /**< worst lateness of an edge in ns */
+} mraa_pwm_jitter_t;
+
 /**
  * Initialise pwm_context, uses board mapping
  *
@@ -55,6 +65,17 @@ typedef struct _pwm* mraa_pwm_context;
  */
 mraa_pwm_context mraa_pwm_init(int pin);
 
+/**
+ * Initialise a software pwm on any gpio capable pin. All software pwm
+ * channels are driven by one realtime thread toggling the gpios, through
+ * mmap where the platform supports it. mraa_pwm_init() falls back to this on
+ * pins without hardware pwm.
+ *
+ * @param pin The gpio capable pin, as labeled on the board
+ * @return pwm context or NULL
+ */
+mraa_pwm_context mraa_pwm_init_soft(int pin);
+
 /**
  * Initialise pwm_context, raw mode
  *
@@ -186,6 +207,16 @@ mraa_result_t mraa_pwm_config_ms(mraa_pwm_context dev, int period, float duty);
  */
 mraa_result_t mraa_pwm_config_percent(mraa_pwm_context dev, int period, float duty);
 
+/**
+ * Get the timing statistics of a software pwm channel since it was last
+ * enabled
+ *
+ * @param dev The pwm context to use
+ * @param stats Filled with the statistics
+ * @return Result of operation, MRAA_ERROR_FEATURE_NOT_SUPPORTED for hardware pwm
+ */
+mraa_result_t mraa_pwm_jitter(mraa_pwm_context dev, mraa_pwm_jitter_t* stats);
+
 /**
  * Get the maximum pwm period in us
  *
@@ -51,6 +51,7 @@ typedef enum {
     // USB platform extenders start at 256
     MRAA_FTDI_FT4222 = 256,         /**< FTDI FT4222 USB to i2c bridge */
 
+    MRAA_FAKE_PLATFORM = 97,        /**< Simulated sysfs and devfs tree rooted at MRAA_FAKE_ROOT */
     MRAA_NULL_PLATFORM = 98,        /**< Platform with no capabilities that hosts a sub platform  */
     MRAA_UNKNOWN_PLATFORM =
     99 /**< An unknown platform type, typically will load INTEL_GALILEO_GEN1 */
@@ -47,6 +47,8 @@ typedef enum {
     BEAGLEBONE = 6,            /**< The different BeagleBone Black Modes B/C */
     BANANA = 7,                /**< Allwinner A20 based Banana Pi and Banana Pro */
 
+    FAKE_PLATFORM = 97,        /**< Simulated sysfs and devfs tree rooted at MRAA_FAKE_ROOT */
+
     UNKNOWN_PLATFORM =
     99 /**< An unknown platform type, typically will load INTEL_GALILEO_GEN1 */
 } Platform;
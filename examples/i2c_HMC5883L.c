@@ -80,7 +80,6 @@ main(int argc, char** argv)
 {
     mraa_init();
     float direction = 0;
-    int16_t x = 0, y = 0, z = 0;
     uint8_t rx_tx_buf[MAX_BUFFER_LENGTH];
 
     //! [Interesting]
@@ -98,39 +97,31 @@ main(int argc, char** argv)
     rx_tx_buf[1] = HMC5883L_CONT_MODE;
     mraa_i2c_write(i2c, rx_tx_buf, 2);
 
+    // the three axes are big endian two's complement pairs starting at
+    // register 0x03, all read in one burst and scaled to milligauss
+    const mraa_i2c_field_t axes[] = {
+        { HMC5883L_DATA_REG + HMC5883L_X_MSB_REG, 2, MRAA_I2C_FIELD_SIGNED, SCALE_0_92_MG, 0 },
+        { HMC5883L_DATA_REG + HMC5883L_Y_MSB_REG, 2, MRAA_I2C_FIELD_SIGNED, SCALE_0_92_MG, 0 },
+        { HMC5883L_DATA_REG + HMC5883L_Z_MSB_REG, 2, MRAA_I2C_FIELD_SIGNED, SCALE_0_92_MG, 0 },
+    };
+    float xyz[3];
+
     for (;;) {
-#if 0
-        int i = 0;
-        //alternative, equivalent method which helps to understand exactly what
-        //the below does
-        mraa_i2c_address(i2c, HMC5883L_I2C_ADDR);
-        for (i = 0; i < DATA_REG_SIZE; i++) {
-            mraa_i2c_read_byte_data(i2c, HMC5883L_DATA_REG+i);
+        mraa_result_t res = mraa_i2c_read_fields_float(i2c, axes, 3, xyz);
+        if (res != MRAA_SUCCESS) {
+            mraa_result_print(res);
+            mraa_i2c_stop(i2c);
+            return EXIT_FAILURE;
         }
-#endif
-        // first 'select' the register we want to read from
-        mraa_i2c_address(i2c, HMC5883L_I2C_ADDR);
-        mraa_i2c_write_byte(i2c, HMC5883L_DATA_REG);
-
-        // then we read from that register incrementing with every read the
-        // chosen register
-        mraa_i2c_address(i2c, HMC5883L_I2C_ADDR);
-        // this call behaves very similarly to the Wire receive() call
-        mraa_i2c_read(i2c, rx_tx_buf, DATA_REG_SIZE);
-
-        x = (rx_tx_buf[HMC5883L_X_MSB_REG] << 8) | rx_tx_buf[HMC5883L_X_LSB_REG];
-        z = (rx_tx_buf[HMC5883L_Z_MSB_REG] << 8) | rx_tx_buf[HMC5883L_Z_LSB_REG];
-        y = (rx_tx_buf[HMC5883L_Y_MSB_REG] << 8) | rx_tx_buf[HMC5883L_Y_LSB_REG];
 
         // scale and calculate direction
-        direction = atan2(y * SCALE_0_92_MG, x * SCALE_0_92_MG);
+        direction = atan2(xyz[1], xyz[0]);
 
         // check if the signs are reversed
         if (direction < 0)
             direction += 2 * M_PI;
 
-        printf("Compass scaled data x : %f, y : %f, z : %f\n", x * SCALE_0_92_MG, y * SCALE_0_92_MG,
-               z * SCALE_0_92_MG);
+        printf("Compass scaled data x : %f, y : %f, z : %f\n", xyz[0], xyz[1], xyz[2]);
         printf("Heading : %f\n", direction * 180 / M_PI);
     }
 }
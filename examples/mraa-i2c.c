@@ -154,17 +154,15 @@ i2c_set_exit:
 void
 i2c_detect_devices(int bus)
 {
-    mraa_result_t status = MRAA_SUCCESS;
-    mraa_i2c_context i2c = mraa_i2c_init(bus);
-    if (i2c == NULL) {
+    uint8_t bitmap[MRAA_I2C_SCAN_BYTES];
+    if (mraa_i2c_scan(bus, bitmap) != MRAA_SUCCESS) {
         return;
     }
     int addr;
     for (addr = 0x0; addr < 0x80; ++addr) {
-        uint8_t value;
         if ((addr) % 16 == 0)
             printf("%02x: ", addr);
-        if (i2c_get(bus, addr, 0, &value) == MRAA_SUCCESS)
+        if (bitmap[addr / 8] & (1 << (addr % 8)))
             printf("%02x ", addr);
         else
             printf("-- ");
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mraa_internal.h"
+
+#define MRAA_FAKE_PINCOUNT 20
+#define MRAA_FAKE_GPIO_COUNT 18
+#define MRAA_FAKE_AIO_COUNT 2
+
+/**
+ * Board whose sysfs and devfs files live under root instead of / so it can
+ * run against a tree populated by tests/fake_sysfs.py. Pins 0-9 are gpio N,
+ * 8 and 9 also pwmchip0 pwm0/1, 10-11 i2c-0, 12-15 spidev0.0, 16-17 the
+ * uart at <root>/dev/ttyFAKE0 and A0/A1 iio:device0 channels 0 and 1.
+ * MRAA_FAKE_SOC names a SoC (am335x, bcm2835, bcm2836, mt7628) whose gpio
+ * registers are then emulated for the mmap fast paths, in memory or in the
+ * directory given by MRAA_MMAP_SIM, never through the real /dev/mem.
+ *
+ * @param root directory standing for /
+ * @return platform type, MRAA_UNKNOWN_PLATFORM if the board could not be set up
+ */
+mraa_platform_t mraa_fake_platform(const char* root);
+
+#ifdef __cplusplus
+}
+#endif
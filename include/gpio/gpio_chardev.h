@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mraa_internal.h"
+
+#define MRAA_GPIOCHIP_LINES_MAX 64
+
+/**
+ * Find the gpiochip character device and line offset backing a gpio number.
+ * The chips are found under /dev once and cached. Gpio numbers are the sysfs
+ * ones when every chip has a sysfs base, otherwise the lines counted across
+ * the chips in /dev/gpiochipN order.
+ *
+ * @param gpio gpio number
+ * @param offset filled with the line offset within the chip
+ * @return open file descriptor to /dev/gpiochipN or -1
+ */
+int mraa_gpiochip_open(int gpio, unsigned int* offset);
+
+/**
+ * Request a set of lines on the same chip as one handle, all get/set calls
+ * on the returned handle act on every line in a single ioctl
+ *
+ * @param chip_fd gpiochip file descriptor from mraa_gpiochip_open()
+ * @param offsets line offsets within the chip
+ * @param num number of lines, at most MRAA_GPIOCHIP_LINES_MAX
+ * @param flags GPIOHANDLE_REQUEST_* flags, 0 keeps the current direction
+ * @param values initial output values, can be NULL
+ * @return line handle file descriptor or -1
+ */
+int mraa_gpiochip_request_lines(int chip_fd, const unsigned int* offsets, int num, unsigned int flags, const uint8_t* values);
+
+/**
+ * Read all lines of a handle in one ioctl
+ *
+ * @param line_fd line handle or line event file descriptor
+ * @param values filled with num values
+ * @param num number of lines in the handle
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpiochip_get_values(int line_fd, uint8_t* values, int num);
+
+/**
+ * Write all lines of a handle in one ioctl
+ *
+ * @param line_fd line handle file descriptor
+ * @param values num values to write
+ * @param num number of lines in the handle
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpiochip_set_values(int line_fd, const uint8_t* values, int num);
+
+/**
+ * Get the gpio function table used by gpiochip contexts. The table is a copy
+ * of base with the gpio functions replaced, so non gpio hooks such as pinmux
+ * setup still run.
+ *
+ * @param base platform function table, can be NULL
+ * @return function table or NULL
+ */
+mraa_adv_func_t* mraa_gpio_chardev_func_table(mraa_adv_func_t* base);
+
+#ifdef __cplusplus
+}
+#endif
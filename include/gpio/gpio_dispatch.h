@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mraa_internal.h"
+
+#define MRAA_GPIO_DISPATCH_MAX_THREADS 8
+
+/**
+ * Register a context with the shared interrupt dispatcher. The dispatcher
+ * threads are started on the first registration. dev->isr is called from a
+ * dispatcher thread every time fd signals, never concurrently for the same
+ * context.
+ *
+ * @param dev gpio context with isr and isr_args set
+ * @param fd sysfs value file or gpiochip line event to wait on
+ * @param chardev fd is a gpiochip line event rather than a sysfs value file
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_dispatch_add(mraa_gpio_context dev, int fd, mraa_boolean_t chardev);
+
+/**
+ * Unregister a context from the dispatcher. Once this returns the isr of dev
+ * is not running and will not be called again, unless called from within
+ * that isr. The dispatcher threads are stopped with the last registration.
+ *
+ * @param dev gpio context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_dispatch_remove(mraa_gpio_context dev);
+
+/**
+ * Set the number of dispatcher threads used the next time the dispatcher
+ * starts
+ *
+ * @param num_threads number of threads, 1 to MRAA_GPIO_DISPATCH_MAX_THREADS
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_dispatch_threads(unsigned int num_threads);
+
+/**
+ * Queue events on a ring, only ever called from the dispatcher thread
+ * servicing the ring's context
+ *
+ * @param ring event ring
+ * @param events events to queue
+ * @param num number of events
+ */
+void mraa_gpio_event_ring_push(mraa_gpio_event_ring_t* ring, const mraa_gpio_event_t* events, int num);
+
+/**
+ * Take events off a ring
+ *
+ * @param ring event ring
+ * @param events filled with at most max events
+ * @param max size of events
+ * @return number of events taken
+ */
+int mraa_gpio_event_ring_pop(mraa_gpio_event_ring_t* ring, mraa_gpio_event_t* events, int max);
+
+/**
+ * Feed edges to a capture, only ever called from the dispatcher thread
+ * servicing the capture's context
+ *
+ * @param capture capture state
+ * @param events edges to account for
+ * @param num number of events
+ */
+void mraa_gpio_capture_push(mraa_gpio_capture_state_t* capture, const mraa_gpio_event_t* events, int num);
+
+/**
+ * Free a capture once its context is no longer dispatched
+ *
+ * @param capture capture state
+ */
+void mraa_gpio_capture_free(mraa_gpio_capture_state_t* capture);
+
+/**
+ * Call the isr of a context, taking the python GIL when needed
+ *
+ * @param dev gpio context
+ */
+void mraa_gpio_isr_call(mraa_gpio_context dev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "mraa_internal.h"
+
+/**
+ * Layout of a GPIO block with write-one-to-set and write-one-to-clear
+ * registers. Only used when registers are simulated, so that writes to SET
+ * and CLEAR show up in the data registers the way they do on the SoC. SET and
+ * CLEAR keep the last value stored so a watcher can tell which one was hit.
+ */
+typedef struct {
+    /*@{*/
+    uint32_t set; /**< first write-one-to-set register */
+    uint32_t clear; /**< first write-one-to-clear register */
+    uint32_t data; /**< first output data register */
+    uint32_t input; /**< first input register, equal to data if the block has none */
+    unsigned int banks; /**< consecutive 32 bit registers in each group */
+    /*@}*/
+} mraa_mmap_sim_t;
+
+/**
+ * A register block used by platform code. Regions of the same file that
+ * overlap share one mapping, so a block is mapped once however many regions
+ * and contexts use it. base stays valid for as long as the caller holds a
+ * reference.
+ */
+typedef struct {
+    /*@{*/
+    const char* path; /**< file to map, /dev/mem, a uio or pci resource */
+    off_t offset; /**< offset of the block in path */
+    size_t size; /**< bytes, 0 for the whole of path */
+    uint8_t* base; /**< first register of the block, NULL while not acquired */
+    unsigned int refs; /**< references taken through this region */
+    void* mapping; /**< shared mapping backing base */
+    const mraa_mmap_sim_t* model; /**< register layout used when simulated, may be NULL */
+    int simulated; /**< base points at simulated registers */
+    /*@}*/
+} mraa_mmap_region_t;
+
+#define MRAA_MMAP_REGION(path, offset, size) { (path), (offset), (size), NULL, 0, NULL, NULL, 0 }
+#define MRAA_MMAP_REGION_SIM(path, offset, size, model) \
+    { (path), (offset), (size), NULL, 0, NULL, (model), 0 }
+
+/**
+ * Take a reference on a region, mapping it on first use. Safe to call from
+ * any thread.
+ *
+ * @param region region to map
+ * @return Result of operation, region->base is set on success
+ */
+mraa_result_t mraa_mmap_acquire(mraa_mmap_region_t* region);
+
+/**
+ * Drop a reference on a region, the mapping goes when nothing uses it
+ *
+ * @param region region acquired with mraa_mmap_acquire()
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_release(mraa_mmap_region_t* region);
+
+/**
+ * Back regions with ordinary memory instead of the device files they name.
+ * With backing NULL or an empty string anonymous memory is used, otherwise
+ * backing is a directory in which one file per mapped block is created so
+ * another process can watch or drive the registers. The MRAA_MMAP_SIM
+ * environment variable selects the same thing, "1" meaning anonymous
+ * memory. Must be called while nothing is mapped.
+ *
+ * @param backing directory for the register files or NULL
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_simulate(const char* backing);
+
+/**
+ * Change the bits of a register selected by mask. Updates through any region
+ * of the same mapping are serialised, so pins sharing a register don't undo
+ * each other. Other processes and the kernel are not excluded.
+ *
+ * @param region acquired region
+ * @param offset byte offset of the register in the region
+ * @param mask bits to change
+ * @param value new value of the bits in mask
+ */
+void mraa_mmap_update32(const mraa_mmap_region_t* region, uint32_t offset, uint32_t mask, uint32_t value);
+
+/**
+ * Write to a simulated region applying SET/CLEAR semantics of its model
+ *
+ * @param region acquired simulated region
+ * @param offset byte offset of the register in the region
+ * @param value value to write
+ */
+void mraa_mmap_sim_write32(const mraa_mmap_region_t* region, uint32_t offset, uint32_t value);
+
+/**
+ * Read a 32 bit register
+ *
+ * @param region acquired region
+ * @param offset byte offset of the register in the region
+ * @return register value
+ */
+static inline uint32_t
+mraa_mmap_read32(const mraa_mmap_region_t* region, uint32_t offset)
+{
+    return *(volatile uint32_t*) (region->base + offset);
+}
+
+/**
+ * Write a 32 bit register
+ *
+ * @param region acquired region
+ * @param offset byte offset of the register in the region
+ * @param value value to write
+ */
+static inline void
+mraa_mmap_write32(const mraa_mmap_region_t* region, uint32_t offset, uint32_t value)
+{
+    if (region->simulated) {
+        mraa_mmap_sim_write32(region, offset, value);
+        return;
+    }
+    *(volatile uint32_t*) (region->base + offset) = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mmap/mmap_region.h"
+
+#define MRAA_MMAP_SOC_BLOCKS 4
+
+/**
+ * GPIO register layout of a SoC. Built on every architecture so the fake
+ * platform can emulate the blocks the ARM and MIPS boards drive.
+ */
+typedef struct {
+    /*@{*/
+    const char* name; /**< name accepted in MRAA_FAKE_SOC */
+    mraa_mmap_sim_t model; /**< SET/CLEAR/DATA/INPUT registers of a block */
+    unsigned int blocks; /**< register blocks, each driving 32 * model.banks gpios */
+    off_t base[MRAA_MMAP_SOC_BLOCKS]; /**< physical address of each block */
+    size_t size; /**< bytes mapped per block */
+    /*@}*/
+} mraa_mmap_soc_t;
+
+extern const mraa_mmap_soc_t mraa_mmap_soc_am335x;
+extern const mraa_mmap_soc_t mraa_mmap_soc_bcm2835;
+extern const mraa_mmap_soc_t mraa_mmap_soc_bcm2836;
+extern const mraa_mmap_soc_t mraa_mmap_soc_mt7628;
+
+/**
+ * Look up a layout by name
+ *
+ * @param name name of the SoC, e.g. "mt7628"
+ * @return layout or NULL if unknown
+ */
+const mraa_mmap_soc_t* mraa_mmap_soc_find(const char* name);
+
+/**
+ * Describe the /dev/mem blocks of a SoC, regions must hold soc->blocks
+ * entries and none of them may be acquired
+ *
+ * @param soc layout
+ * @param regions regions to fill in
+ */
+void mraa_mmap_soc_regions(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions);
+
+/**
+ * Region holding the registers of a gpio
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param pin gpio number
+ * @return region or NULL if the SoC has no such gpio
+ */
+mraa_mmap_region_t* mraa_mmap_soc_block(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin);
+
+/**
+ * Take or drop a reference on the block holding a 32 bit bank
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param bank bank number, gpio / 32
+ * @param en 1 to map the block, 0 to release it
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_soc_bank_setup(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, unsigned int bank, mraa_boolean_t en);
+
+/**
+ * Drive a gpio through its SET or CLEAR register, its block must be acquired
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param pin gpio number
+ * @param value 0 to clear, set otherwise
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_soc_gpio_write(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin, int value);
+
+/**
+ * Read a gpio from its input register, its block must be acquired
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param pin gpio number
+ * @return 0 or 1
+ */
+int mraa_mmap_soc_gpio_read(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin);
+
+/**
+ * Drive the gpios of a 32 bit bank selected by mask with one SET and one
+ * CLEAR store
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param bank bank number, gpio / 32
+ * @param mask gpios to drive
+ * @param value levels for the gpios in mask
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_soc_bank_write(const mraa_mmap_soc_t* soc,
+                                       mraa_mmap_region_t* regions,
+                                       unsigned int bank,
+                                       uint32_t mask,
+                                       uint32_t value);
+
+/**
+ * Read the input register of a 32 bit bank
+ *
+ * @param soc layout
+ * @param regions regions filled in by mraa_mmap_soc_regions()
+ * @param bank bank number, gpio / 32
+ * @param value levels of the bank
+ * @return Result of operation
+ */
+mraa_result_t mraa_mmap_soc_bank_read(const mraa_mmap_soc_t* soc,
+                                      mraa_mmap_region_t* regions,
+                                      unsigned int bank,
+                                      uint32_t* value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -32,7 +32,7 @@
 #define IS_FUNC_DEFINED(dev, func)   (dev != NULL && dev->advance_func != NULL && dev->advance_func->func != NULL)
 
 typedef struct {
-    mraa_result_t (*gpio_init_internal_replace) (int pin);
+    mraa_result_t (*gpio_init_internal_replace) (mraa_gpio_context dev, int pin);
     mraa_result_t (*gpio_init_pre) (int pin);
     mraa_result_t (*gpio_init_post) (mraa_gpio_context dev);
 
@@ -54,6 +54,11 @@ typedef struct {
     mraa_result_t (*gpio_write_post) (mraa_gpio_context dev, int value);
     mraa_result_t (*gpio_mmap_setup) (mraa_gpio_context dev, mraa_boolean_t en);
     void* (*gpio_interrupt_handler_replace) (mraa_gpio_context dev); 
+    mraa_result_t (*gpio_wait_interrupt_replace) (mraa_gpio_context dev, int timeout_ms, int* value);
+    mraa_result_t (*gpio_isr_poll_setup) (mraa_gpio_context dev, int cpu);
+    mraa_result_t (*gpio_mmap_bank_write) (unsigned int bank, uint32_t mask, uint32_t value);
+    mraa_result_t (*gpio_mmap_bank_read) (unsigned int bank, uint32_t* value);
+    mraa_result_t (*gpio_mmap_bank_setup) (unsigned int bank, mraa_boolean_t en);
 
     mraa_result_t (*i2c_init_pre) (unsigned int bus);
     mraa_result_t (*i2c_init_bus_replace) (mraa_i2c_context dev);
@@ -70,6 +75,7 @@ typedef struct {
     mraa_result_t (*i2c_write_byte_replace) (mraa_i2c_context dev, uint8_t data);
     mraa_result_t (*i2c_write_byte_data_replace) (mraa_i2c_context dev, const uint8_t data, const uint8_t command);
     mraa_result_t (*i2c_write_word_data_replace) (mraa_i2c_context dev, const uint16_t data, const uint8_t command);
+    mraa_result_t (*i2c_transfer_replace) (mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int count);
     mraa_result_t (*i2c_stop_replace) (mraa_i2c_context dev);
 
     mraa_result_t (*aio_get_valid_fp) (mraa_aio_context dev);
@@ -80,6 +86,10 @@ typedef struct {
     mraa_result_t (*pwm_init_pre) (int pin);
     mraa_result_t (*pwm_init_post) (mraa_pwm_context pwm);
     mraa_result_t (*pwm_period_replace) (mraa_pwm_context dev, int period);
+    mraa_result_t (*pwm_duty_replace) (mraa_pwm_context dev, int duty);
+    int (*pwm_read_period_replace) (mraa_pwm_context dev);
+    int (*pwm_read_duty_replace) (mraa_pwm_context dev);
+    mraa_result_t (*pwm_enable_post) (mraa_pwm_context dev, int enable);
 
     mraa_result_t (*spi_init_pre) (int bus);
     mraa_result_t (*spi_init_post) (mraa_spi_context spi);
@@ -29,6 +29,7 @@ extern "C" {
 #endif
 
 #include <syslog.h>
+#include <sys/types.h>
 
 #include "common.h"
 #include "mraa_internal_types.h"
@@ -44,6 +45,32 @@ extern mraa_board_t* plat;
  */
 mraa_result_t mraa_setup_mux_mapped(mraa_pin_t meta);
 
+/**
+ * Collect the gpio lines named in the mux tables of the board and its sub
+ * platform, only those are tracked by mraa_mux_track_open()
+ */
+void mraa_mux_pins_init();
+
+/**
+ * Count a gpio context opened on a line that is also a mux, the mux
+ * controller then stops trusting its cached value for that line.
+ *
+ * @param dev gpio context just opened
+ */
+void mraa_mux_track_open(mraa_gpio_context dev);
+
+/**
+ * Counterpart of mraa_mux_track_open() called when a gpio context is closed
+ *
+ * @param dev gpio context being closed
+ */
+void mraa_mux_track_close(mraa_gpio_context dev);
+
+/**
+ * Close every gpio line held open by the mux controller
+ */
+void mraa_mux_release_all();
+
 /**
  * runtime detect running x86 platform
  *
@@ -72,6 +99,39 @@ mraa_platform_t mraa_usb_platform_extender(mraa_board_t* board);
  */
 mraa_platform_t mraa_mips_platform();
 
+/**
+ * Prefix every kernel interface path with root, used by the fake platform
+ * to redirect sysfs and devfs into an ordinary directory tree
+ *
+ * @param root directory standing for /, NULL to use the real filesystem
+ * @return Result of operation
+ */
+mraa_result_t mraa_set_sysfs_root(const char* root);
+
+/**
+ * Format a sysfs or devfs path like snprintf, prepending the root set with
+ * mraa_set_sysfs_root(). fmt must be an absolute path such as
+ * "/sys/class/gpio/gpio%d/value".
+ *
+ * @param buf destination
+ * @param len size of buf
+ * @param fmt printf format of the path
+ * @return length of the full path, >= len when it was truncated
+ */
+int mraa_sysfs_path(char* buf, size_t len, const char* fmt, ...);
+
+/**
+ * Write a whole sysfs attribute value at offset 0. Under a fake root the
+ * file is left holding just the value and a newline, which is what reading
+ * the attribute back from sysfs shows.
+ *
+ * @param fd open attribute
+ * @param value bytes to write
+ * @param length number of bytes
+ * @return bytes written or -1
+ */
+ssize_t mraa_sysfs_pwrite(int fd, const char* value, size_t length);
+
 /**
  * helper function to check if file exists
  *
@@ -118,6 +178,44 @@ mraa_boolean_t mraa_file_contains_both(const char* filename, const char* content
  */
 mraa_boolean_t mraa_link_targets(const char* filename, const char* targetname);
 
+/**
+ * Reset a sysfs attribute cache entry, nothing is opened until first use
+ *
+ * @param attr attribute cache entry
+ */
+void mraa_sysfs_attr_init(mraa_sysfs_attr_t* attr);
+
+/**
+ * Write a sysfs attribute with a single pwrite, opening it on first use. When
+ * cache is set and value is the last value written nothing is done.
+ *
+ * @param attr attribute cache entry
+ * @param path attribute file, only used to open it
+ * @param value value to write
+ * @param length length of value
+ * @param cache skip the write if value is unchanged
+ * @return Result of operation, attr->fd is -1 if the file could not be opened
+ */
+mraa_result_t mraa_sysfs_attr_write(mraa_sysfs_attr_t* attr, const char* path, const char* value, int length, mraa_boolean_t cache);
+
+/**
+ * Read a sysfs attribute with a single pread, opening it on first use
+ *
+ * @param attr attribute cache entry
+ * @param path attribute file, only used to open it
+ * @param buf filled with the nul terminated value
+ * @param size size of buf
+ * @return number of bytes read or -1
+ */
+int mraa_sysfs_attr_read(mraa_sysfs_attr_t* attr, const char* path, char* buf, int size);
+
+/**
+ * Close a sysfs attribute if it was opened
+ *
+ * @param attr attribute cache entry
+ */
+void mraa_sysfs_attr_close(mraa_sysfs_attr_t* attr);
+
 /**
  * helper function to find the first i2c bus containing devname starting from
  * i2c-n where n is startfrom
@@ -35,6 +35,53 @@
 #define MRAA_IO_SETUP_FAILURE -2
 #define MRAA_NO_SUCH_IO -1
 
+#define MRAA_SYSFS_ATTR_VALUE_MAX 16
+
+/**
+ * A sysfs attribute file kept open between accesses, with the last value
+ * written so that rewriting the same value can be skipped
+ */
+typedef struct {
+    /*@{*/
+    int fd; /**< attribute file, -1 until first used */
+    int length; /**< length of value, -1 when unknown */
+    char value[MRAA_SYSFS_ATTR_VALUE_MAX]; /**< last value written */
+    /*@}*/
+} mraa_sysfs_attr_t;
+
+/**
+ * Single producer single consumer queue of gpio edges. The dispatcher thread
+ * only writes head and the reader only writes tail.
+ */
+typedef struct {
+    /*@{*/
+    mraa_gpio_event_t* buf; /**< size events */
+    unsigned int size; /**< power of two */
+    unsigned int head; /**< next slot written, free running */
+    unsigned int tail; /**< next slot read, free running */
+    unsigned int dropped; /**< events lost to a full queue */
+    /*@}*/
+} mraa_gpio_event_ring_t;
+
+/**
+ * Rolling window capture of an input signal, fed by the dispatcher thread
+ */
+typedef struct {
+    /*@{*/
+    pthread_mutex_t lock; /**< protects everything below */
+    int flags; /**< MRAA_CAPTURE_* */
+    unsigned int window; /**< size of each history */
+    uint64_t* periods; /**< rising to rising, window entries */
+    uint64_t* highs; /**< rising to falling, window entries */
+    uint64_t* lows; /**< falling to rising, window entries */
+    unsigned int num_periods; /**< measurements taken, only the last window are kept */
+    unsigned int num_highs; /**< measurements taken, only the last window are kept */
+    unsigned int num_lows; /**< measurements taken, only the last window are kept */
+    uint64_t last_rise; /**< timestamp of the last rising edge, 0 before the first */
+    uint64_t last_fall; /**< timestamp of the last falling edge, 0 before the first */
+    /*@}*/
+} mraa_gpio_capture_state_t;
+
 /**
  * A structure representing a gpio pin.
  */
@@ -47,9 +94,50 @@ struct _gpio {
     void *isr_args; /**< args return when interupt service request triggered */
     pthread_t thread_id; /**< the isr handler thread id */
     int isr_value_fp; /**< the isr file pointer on the value */
+    mraa_boolean_t isr_dispatched; /**< isr is serviced by the shared dispatcher */
+    int isr_priority; /**< dispatcher priority, higher is serviced first */
+    mraa_gpio_event_ring_t* events; /**< edge queue when capturing with mraa_gpio_events() */
+    mraa_gpio_capture_state_t* capture; /**< signal measurement from mraa_gpio_capture_start() */
+    mraa_sysfs_attr_t direction; /**< sysfs direction attribute */
+    mraa_sysfs_attr_t edge; /**< sysfs edge attribute */
+    mraa_sysfs_attr_t drive; /**< sysfs drive attribute */
     mraa_boolean_t owner; /**< If this context originally exported the pin */
     mraa_result_t (*mmap_write) (mraa_gpio_context dev, int value);
     int (*mmap_read) (mraa_gpio_context dev);
+    int chip_fd; /**< gpiochip character device, -1 when using sysfs */
+    unsigned int line_offset; /**< line offset of the pin within chip_fd */
+    int line_fd; /**< line handle or line event requested on chip_fd */
+    unsigned int line_flags; /**< GPIOHANDLE_REQUEST_* flags of line_fd */
+    unsigned int line_eventflags; /**< GPIOEVENT_REQUEST_* flags, 0 if line_fd is not an event */
+    mraa_adv_func_t* advance_func; /**< override function table */
+    /*@}*/
+};
+
+/**
+ * A gpiochip line handle owned by a gpio group
+ */
+typedef struct {
+    /*@{*/
+    int chip_fd; /**< gpiochip fd, borrowed from the first pin context on the chip */
+    int line_fd; /**< line handle covering every group pin on the chip */
+    int num_lines; /**< lines in the handle */
+    unsigned int offsets[64]; /**< line offsets in request order */
+    /*@}*/
+} mraa_gpio_group_chip_t;
+
+/**
+ * A structure representing a group of gpios read and written together
+ */
+struct _gpio_group {
+    /*@{*/
+    int num_pins; /**< pins in the group, bit n of a value is pin n */
+    mraa_gpio_context* gpio; /**< per pin contexts, muxing and fallback io */
+    mraa_boolean_t mmap; /**< every pin can use the bank registers */
+    uint32_t mmap_banks; /**< banks mapped by the group itself, bit n is bank n */
+    int num_chips; /**< number of chardev line handles, 0 when not chardev */
+    mraa_gpio_group_chip_t* chips; /**< chardev line handles */
+    int* pin_chip; /**< index into chips of every pin */
+    int* pin_line; /**< index into the chip handle of every pin */
     mraa_adv_func_t* advance_func; /**< override function table */
     /*@}*/
 };
@@ -60,14 +148,33 @@ struct _gpio {
 struct _i2c {
     /*@{*/
     int busnum; /**< the bus number of the /dev/i2c-* device */
-    int fh; /**< the file handle to the /dev/i2c-* device */
+    int fh; /**< the file handle to the /dev/i2c-* device, shared by every context on the bus */
+    struct _i2c_shared_bus* bus; /**< shared /dev/i2c-* state, NULL when a platform replaces the bus */
     int addr; /**< the address of the i2c slave */
     unsigned long funcs; /**< /dev/i2c-* device capabilities as per https://www.kernel.org/doc/Documentation/i2c/functionality */
+    int max_transfer; /**< largest message payload, 0 for the i2c-dev limit */
+    mraa_boolean_t auto_increment; /**< split writes advance the register between pieces */
+    struct _i2c_queue* queue; /**< bus worker, NULL until the first mraa_i2c_submit() */
+    int pending; /**< submitted transactions not yet completed */
     void *handle; /**< generic handle for non-standard drivers that don't use file descriptors  */
     mraa_adv_func_t* advance_func; /**< override function table */
     /*@}*/
 };
 
+/**
+ * A cached register map of one i2c slave
+ */
+struct _i2c_regmap {
+    /*@{*/
+    mraa_i2c_context i2c; /**< bus the slave is on */
+    uint8_t addr; /**< slave address */
+    int val_bytes; /**< register width in bytes */
+    int num_regs; /**< registers 0 to num_regs - 1 */
+    unsigned int* cache; /**< cached values */
+    uint8_t* state; /**< per register flags and cache state */
+    /*@}*/
+};
+
 /**
  * A structure representing the SPI device
  */
@@ -82,6 +189,28 @@ struct _spi {
     /*@}*/
 };
 
+/**
+ * A channel of the software pwm engine, all fields are protected by the
+ * engine lock
+ */
+struct _pwm_soft {
+    /*@{*/
+    mraa_gpio_context gpio; /**< the gpio toggled */
+    int period; /**< period in ns, applied at the next period start */
+    int duty; /**< high time in ns, applied at the next period start */
+    int cur_period; /**< period in ns of the current period */
+    int cur_duty; /**< high time in ns of the current period */
+    mraa_boolean_t enabled; /**< channel is in the event queue */
+    mraa_boolean_t rising; /**< next event starts a period, else it ends the high time */
+    int level; /**< level last written to gpio */
+    uint64_t period_start; /**< CLOCK_MONOTONIC ns of the current period start */
+    uint64_t next; /**< CLOCK_MONOTONIC ns of the next event */
+    uint64_t edges; /**< events handled since enabled */
+    uint64_t jitter_total; /**< sum of event lateness in ns */
+    uint32_t jitter_max; /**< worst event lateness in ns */
+    /*@}*/
+};
+
 /**
  * A structure representing a PWM pin
  */
@@ -92,6 +221,9 @@ struct _pwm {
     int duty_fp; /**< File pointer to duty file */
     int period;  /**< Cache the period to speed up setting duty */
     mraa_boolean_t owner; /**< Owner of pwm context*/
+    struct _pwm_soft* soft; /**< software pwm channel, NULL for sysfs pwm */
+    mraa_sysfs_attr_t period_attr; /**< sysfs period attribute */
+    mraa_sysfs_attr_t enable_attr; /**< sysfs enable attribute */
     mraa_adv_func_t* advance_func; /**< override function table */
     /*@}*/
 };
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mraa_internal.h"
+
+#define MRAA_PWM_SOFT_MAX_CHANNELS 32
+#define MRAA_PWM_SOFT_MIN_PERIOD_US 100
+#define MRAA_PWM_SOFT_MAX_PERIOD_US 1000000
+
+/**
+ * Attach a software pwm channel to a pwm context. The channel toggles gpio
+ * from the shared software pwm thread, which is started with the first
+ * channel.
+ *
+ * @param dev pwm context, period must already be set
+ * @param gpio output gpio, owned by the channel from now on
+ * @return Result of operation
+ */
+mraa_result_t mraa_pwm_soft_attach(mraa_pwm_context dev, mraa_gpio_context gpio);
+
+/**
+ * Set the period of a software pwm channel, applied from the next period
+ *
+ * @param dev pwm context
+ * @param period period in ns
+ * @return Result of operation
+ */
+mraa_result_t mraa_pwm_soft_period(mraa_pwm_context dev, int period);
+
+/**
+ * Set the duty cycle of a software pwm channel, applied from the next period
+ *
+ * @param dev pwm context
+ * @param duty high time in ns
+ * @return Result of operation
+ */
+mraa_result_t mraa_pwm_soft_duty(mraa_pwm_context dev, int duty);
+
+/**
+ * Get the duty cycle of a software pwm channel
+ *
+ * @param dev pwm context
+ * @return high time in ns
+ */
+int mraa_pwm_soft_read_duty(mraa_pwm_context dev);
+
+/**
+ * Start or stop a software pwm channel, a stopped channel drives its gpio low
+ *
+ * @param dev pwm context
+ * @param enable non zero to start
+ * @return Result of operation
+ */
+mraa_result_t mraa_pwm_soft_enable(mraa_pwm_context dev, int enable);
+
+/**
+ * Detach and free the software pwm channel of a context and close its gpio.
+ * The thread is stopped with the last channel.
+ *
+ * @param dev pwm context
+ * @return Result of operation
+ */
+mraa_result_t mraa_pwm_soft_detach(mraa_pwm_context dev);
+
+#ifdef __cplusplus
+}
+#endif
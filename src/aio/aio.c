@@ -41,10 +41,10 @@ aio_get_valid_fp(mraa_aio_context dev)
         return dev->advance_func->aio_get_valid_fp(dev);
     }
 
-    char file_path[64] = "";
+    char file_path[128] = "";
 
     // Open file Analog device input channel raw voltage file for reading.
-    snprintf(file_path, 64, "/sys/bus/iio/devices/iio:device0/in_voltage%d_raw", dev->channel);
+    mraa_sysfs_path(file_path, sizeof(file_path), "/sys/bus/iio/devices/iio:device0/in_voltage%d_raw", dev->channel);
 
     dev->adc_in_fp = open(file_path, O_RDONLY);
     if (dev->adc_in_fp == -1) {
@@ -147,13 +147,13 @@ mraa_aio_read(mraa_aio_context dev)
         }
     }
 
-    lseek(dev->adc_in_fp, 0, SEEK_SET);
-    if (read(dev->adc_in_fp, buffer, sizeof(buffer)) < 1) {
+    ssize_t rb = pread(dev->adc_in_fp, buffer, sizeof(buffer) - 1, 0);
+    if (rb < 1) {
         syslog(LOG_ERR, "aio: Failed to read a sensible value");
+        rb = 0;
     }
     // force NULL termination of string
-    buffer[16] = '\0';
-    lseek(dev->adc_in_fp, 0, SEEK_SET);
+    buffer[rb] = '\0';
 
     errno = 0;
     char* end;
@@ -31,6 +31,7 @@
 
 #include "common.h"
 #include "arm/banana.h"
+#include "mmap/mmap_region.h"
 
 #define PLATFORM_NAME_BANANA_PI "Banana Pi"
 #define PLATFORM_BANANA_PI 1
@@ -46,10 +47,7 @@
 #define MAX_SIZE 64
 
 // MMAP
-static uint8_t* mmap_reg = NULL;
-static int mmap_fd = 0;
-static int mmap_size;
-static unsigned int mmap_count = 0;
+static mraa_mmap_region_t gpio_region = MRAA_MMAP_REGION(MMAP_PATH, SUNXI_BASE, SUNXI_BLOCK_SIZE);
 static int platform_detected = 0;
 
 const char* serialdev[] = { "/dev/ttyS0", "/dev/ttyS1", "/dev/ttyS2", "/dev/ttyS3",
@@ -105,15 +103,12 @@ mraa_banana_i2c_init_pre(unsigned int bus)
 mraa_result_t
 mraa_banana_mmap_write(mraa_gpio_context dev, int value)
 {
-    uint32_t readvalue =
-    *(volatile uint32_t*) (mmap_reg + SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET);
-    volatile uint32_t* addr;
+    uint32_t offset = SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET;
+    uint32_t readvalue = mraa_mmap_read32(&gpio_region, offset);
     if (value) {
-        *(volatile uint32_t*) (mmap_reg + SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET) =
-        (uint32_t)((1 << (dev->pin % 32)) | readvalue);
+        mraa_mmap_write32(&gpio_region, offset, (uint32_t)((1 << (dev->pin % 32)) | readvalue));
     } else {
-        *(volatile uint32_t*) (mmap_reg + SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET) =
-        (uint32_t)(~(1 << (dev->pin % 32)) & readvalue);
+        mraa_mmap_write32(&gpio_region, offset, (uint32_t)(~(1 << (dev->pin % 32)) & readvalue));
     }
     return MRAA_SUCCESS;
 }
@@ -121,29 +116,13 @@ mraa_banana_mmap_write(mraa_gpio_context dev, int value)
 int
 mraa_banana_mmap_read(mraa_gpio_context dev)
 {
-    uint32_t value =
-    *(volatile uint32_t*) (mmap_reg + SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET);
+    uint32_t value = mraa_mmap_read32(&gpio_region, SUNXI_GPIO_DAT + (dev->pin / 32) * SUNXI_GPIO_PORT_OFFSET);
     if (value & (uint32_t)(1 << (dev->pin % 32))) {
         return 1;
     }
     return 0;
 }
 
-static mraa_result_t
-mraa_banana_mmap_unsetup()
-{
-    if (mmap_reg == NULL) {
-        syslog(LOG_ERR, "banana mmap: cannot unsetup NULLed mmap");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    munmap(mmap_reg, mmap_size);
-    mmap_reg = NULL;
-    if (close(mmap_fd) != 0) {
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    return MRAA_SUCCESS;
-}
-
 mraa_result_t
 mraa_banana_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
 {
@@ -159,11 +138,7 @@ mraa_banana_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_banana_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(&gpio_region);
     }
 
     if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
@@ -171,27 +146,12 @@ mraa_banana_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    // Might need to make some elements of this thread safe.
-    // For example only allow one thread to enter the following block
-    // to prevent mmap'ing twice.
-    if (mmap_reg == NULL) {
-        if ((mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "Banana mmap: unable to open /dev/mem file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-
-        mmap_reg = (uint8_t*) mmap(NULL, SUNXI_BLOCK_SIZE, PROT_READ | PROT_WRITE,
-                                   MAP_FILE | MAP_SHARED, mmap_fd, SUNXI_BASE);
-        if (mmap_reg == MAP_FAILED) {
-            syslog(LOG_ERR, "Banana mmap: failed to mmap");
-            mmap_reg = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    if (mraa_mmap_acquire(&gpio_region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "Banana mmap: failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     dev->mmap_write = &mraa_banana_mmap_write;
     dev->mmap_read = &mraa_banana_mmap_read;
-    mmap_count++;
 
     return MRAA_SUCCESS;
 }
@@ -30,6 +30,7 @@
 
 #include "common.h"
 #include "arm/beaglebone.h"
+#include "mmap/mmap_soc.h"
 
 #define NUM2STR(x) #x
 
@@ -46,62 +47,37 @@
 #define I2C_OVERLAY(x) "ADAFRUIT-I2C" NUM2STR(x)
 #define MAX_SIZE 64
 
-#define MMAP_PATH "/dev/mem"
-#define AM335X_GPIO0_BASE 0x44e07000
-#define AM335X_GPIO1_BASE 0x4804c000
-#define AM335X_GPIO2_BASE 0x481AC000
-#define AM335X_GPIO3_BASE 0x481AE000
-#define AM335X_GPIO_SIZE (4 * 1024)
-#define AM335X_IN 0x138
-#define AM335X_CLR 0x190
-#define AM335X_SET 0x194
-
-// MMAP
-static uint8_t* mmap_gpio[4] = { NULL, NULL, NULL, NULL };
-static int mmap_fd = 0;
-static unsigned int mmap_count = 0;
+// MMAP, one block per bank mapped when a pin of the bank needs it
+static mraa_mmap_region_t gpio_region[MRAA_MMAP_SOC_BLOCKS];
 
 mraa_result_t
 mraa_beaglebone_mmap_write(mraa_gpio_context dev, int value)
 {
-    volatile uint32_t* addr;
-    if (value) {
-        *(volatile uint32_t*) (mmap_gpio[dev->pin / 32] + AM335X_SET) = (uint32_t)(1 << (dev->pin % 32));
-    } else {
-        *(volatile uint32_t*) (mmap_gpio[dev->pin / 32] + AM335X_CLR) = (uint32_t)(1 << (dev->pin % 32));
-    }
-    return MRAA_SUCCESS;
+    return mraa_mmap_soc_gpio_write(&mraa_mmap_soc_am335x, gpio_region, dev->pin, value);
+}
+
+int
+mraa_beaglebone_mmap_read(mraa_gpio_context dev)
+{
+    return mraa_mmap_soc_gpio_read(&mraa_mmap_soc_am335x, gpio_region, dev->pin);
 }
 
 static mraa_result_t
-mraa_beaglebone_mmap_unsetup()
+mraa_beaglebone_mmap_bank_write(unsigned int bank, uint32_t mask, uint32_t value)
 {
-    if (mmap_gpio[0] == NULL) {
-        syslog(LOG_ERR, "beaglebone mmap: null register cant unsetup");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    munmap(mmap_gpio[0], AM335X_GPIO_SIZE);
-    mmap_gpio[0] = NULL;
-    munmap(mmap_gpio[1], AM335X_GPIO_SIZE);
-    mmap_gpio[1] = NULL;
-    munmap(mmap_gpio[2], AM335X_GPIO_SIZE);
-    mmap_gpio[2] = NULL;
-    munmap(mmap_gpio[3], AM335X_GPIO_SIZE);
-    mmap_gpio[3] = NULL;
-    if (close(mmap_fd) != 0) {
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    return MRAA_SUCCESS;
+    return mraa_mmap_soc_bank_write(&mraa_mmap_soc_am335x, gpio_region, bank, mask, value);
 }
 
-int
-mraa_beaglebone_mmap_read(mraa_gpio_context dev)
+static mraa_result_t
+mraa_beaglebone_mmap_bank_read(unsigned int bank, uint32_t* value)
 {
-    uint32_t value = *(volatile uint32_t*) (mmap_gpio[dev->pin / 32] + AM335X_IN);
-    if (value & (uint32_t)(1 << (dev->pin % 32))) {
-        return 1;
-    }
-    return 0;
+    return mraa_mmap_soc_bank_read(&mraa_mmap_soc_am335x, gpio_region, bank, value);
+}
+
+static mraa_result_t
+mraa_beaglebone_mmap_bank_setup(unsigned int bank, mraa_boolean_t en)
+{
+    return mraa_mmap_soc_bank_setup(&mraa_mmap_soc_am335x, gpio_region, bank, en);
 }
 
 mraa_result_t
@@ -111,6 +87,11 @@ mraa_beaglebone_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         syslog(LOG_ERR, "beaglebone mmap: context not valid");
         return MRAA_ERROR_INVALID_HANDLE;
     }
+    mraa_mmap_region_t* region = mraa_mmap_soc_block(&mraa_mmap_soc_am335x, gpio_region, dev->pin);
+    if (region == NULL) {
+        syslog(LOG_ERR, "beaglebone mmap: gpio%d not in a bank", dev->pin);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
 
     if (en == 0) {
         if (dev->mmap_write == NULL && dev->mmap_read == NULL) {
@@ -119,11 +100,7 @@ mraa_beaglebone_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_beaglebone_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(region);
     }
 
     if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
@@ -131,51 +108,12 @@ mraa_beaglebone_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    // Might need to make some elements of this thread safe.
-    // For example only allow one thread to enter the following block
-    // to prevent mmap'ing twice.
-    if (mmap_gpio[0] == NULL) {
-        if ((mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "beaglebone map: unable to open resource0 file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-
-        mmap_gpio[0] = (uint8_t*) mmap(NULL, AM335X_GPIO_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, AM335X_GPIO0_BASE);
-        if (mmap_gpio[0] == MAP_FAILED) {
-            syslog(LOG_ERR, "beaglebone mmap: failed to mmap");
-            mmap_gpio[0] = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
-        mmap_gpio[1] = (uint8_t*) mmap(NULL, AM335X_GPIO_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, AM335X_GPIO1_BASE);
-        if (mmap_gpio[1] == MAP_FAILED) {
-            syslog(LOG_ERR, "beaglebone mmap: failed to mmap");
-            mmap_gpio[1] = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
-        mmap_gpio[2] = (uint8_t*) mmap(NULL, AM335X_GPIO_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, AM335X_GPIO2_BASE);
-        if (mmap_gpio[2] == MAP_FAILED) {
-            syslog(LOG_ERR, "beaglebone mmap: failed to mmap");
-            mmap_gpio[2] = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
-        mmap_gpio[3] = (uint8_t*) mmap(NULL, AM335X_GPIO_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, AM335X_GPIO3_BASE);
-        if (mmap_gpio[3] == MAP_FAILED) {
-            syslog(LOG_ERR, "beaglebone mmap: failed to mmap");
-            mmap_gpio[3] = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    if (mraa_mmap_acquire(region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "beaglebone mmap: failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     dev->mmap_write = &mraa_beaglebone_mmap_write;
     dev->mmap_read = &mraa_beaglebone_mmap_read;
-    mmap_count++;
 
     return MRAA_SUCCESS;
 }
@@ -356,10 +294,12 @@ mraa_beaglebone_pwm_init_replace(int pin)
     }
 
     if (mraa_file_exist(devpath)) {
-        mraa_pwm_context dev = (mraa_pwm_context) malloc(sizeof(struct _pwm));
+        mraa_pwm_context dev = (mraa_pwm_context) calloc(1, sizeof(struct _pwm));
         if (dev == NULL)
             return NULL;
         dev->duty_fp = -1;
+        mraa_sysfs_attr_init(&dev->period_attr);
+        mraa_sysfs_attr_init(&dev->enable_attr);
         dev->chipid = -1;
         dev->pin = plat->pins[pin].pwm.pinmap;
         dev->period = -1;
@@ -527,6 +467,12 @@ mraa_beaglebone()
     b->adv_func->spi_init_pre = &mraa_beaglebone_spi_init_pre;
     b->adv_func->i2c_init_pre = &mraa_beaglebone_i2c_init_pre;
     b->adv_func->pwm_init_replace = &mraa_beaglebone_pwm_init_replace;
+    // no gpio_mmap_setup, every gpio init would map /dev/mem and need root.
+    // Groups map the banks they use and fall back to sysfs if they can't
+    mraa_mmap_soc_regions(&mraa_mmap_soc_am335x, gpio_region);
+    b->adv_func->gpio_mmap_bank_write = &mraa_beaglebone_mmap_bank_write;
+    b->adv_func->gpio_mmap_bank_read = &mraa_beaglebone_mmap_bank_read;
+    b->adv_func->gpio_mmap_bank_setup = &mraa_beaglebone_mmap_bank_setup;
 
     strncpy(b->pins[0].name, "INVALID", MRAA_PIN_NAME_SIZE);
     b->pins[0].capabilites = (mraa_pincapabilities_t){ 0, 0, 0, 0, 0, 0, 0, 0 };
@@ -30,6 +30,7 @@
 
 #include "common.h"
 #include "arm/raspberry_pi.h"
+#include "mmap/mmap_soc.h"
 
 #define PLATFORM_NAME_RASPBERRY_PI_B_REV_1 "Raspberry Pi Model B Rev 1"
 #define PLATFORM_NAME_RASPBERRY_PI_A_REV_2 "Raspberry Pi Model A Rev 2"
@@ -45,23 +46,11 @@
 #define PLATFORM_RASPBERRY_PI_COMPUTE_MODULE_REV_1 5
 #define PLATFORM_RASPBERRY_PI_A_PLUS_REV_1 6
 #define PLATFORM_RASPBERRY_PI2_B_REV_1 7
-#define MMAP_PATH "/dev/mem"
-#define BCM2835_PERI_BASE 0x20000000
-#define BCM2835_GPIO_BASE (BCM2835_PERI_BASE + 0x200000)
-#define BCM2836_PERI_BASE 0x3f000000
-#define BCM2836_GPIO_BASE (BCM2836_PERI_BASE + 0x200000)
-#define BCM2835_BLOCK_SIZE (4 * 1024)
-#define BCM2836_BLOCK_SIZE (4 * 1024)
-#define BCM283X_GPSET0 0x001c
-#define BCM283X_GPCLR0 0x0028
-#define BCM2835_GPLEV0 0x0034
 #define MAX_SIZE 64
 
-// MMAP
-static uint8_t* mmap_reg = NULL;
-static int mmap_fd = 0;
-static int mmap_size;
-static unsigned int mmap_count = 0;
+// MMAP, the block moved on the Pi 2
+static const mraa_mmap_soc_t* gpio_soc = &mraa_mmap_soc_bcm2835;
+static mraa_mmap_region_t gpio_region;
 static int platform_detected = 0;
 
 mraa_result_t
@@ -112,40 +101,31 @@ mraa_raspberry_pi_i2c_init_pre(unsigned int bus)
 mraa_result_t
 mraa_raspberry_pi_mmap_write(mraa_gpio_context dev, int value)
 {
-    volatile uint32_t* addr;
-    if (value) {
-        *(volatile uint32_t*) (mmap_reg + BCM283X_GPSET0 + (dev->pin / 32) * 4) =
-        (uint32_t)(1 << (dev->pin % 32));
-    } else {
-        *(volatile uint32_t*) (mmap_reg + BCM283X_GPCLR0 + (dev->pin / 32) * 4) =
-        (uint32_t)(1 << (dev->pin % 32));
-    }
-    return MRAA_SUCCESS;
+    return mraa_mmap_soc_gpio_write(gpio_soc, &gpio_region, dev->pin, value);
+}
+
+int
+mraa_raspberry_pi_mmap_read(mraa_gpio_context dev)
+{
+    return mraa_mmap_soc_gpio_read(gpio_soc, &gpio_region, dev->pin);
 }
 
 static mraa_result_t
-mraa_raspberry_pi_mmap_unsetup()
+mraa_raspberry_pi_mmap_bank_write(unsigned int bank, uint32_t mask, uint32_t value)
 {
-    if (mmap_reg == NULL) {
-        syslog(LOG_ERR, "raspberry mmap: null register cant unsetup");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    munmap(mmap_reg, mmap_size);
-    mmap_reg = NULL;
-    if (close(mmap_fd) != 0) {
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    return MRAA_SUCCESS;
+    return mraa_mmap_soc_bank_write(gpio_soc, &gpio_region, bank, mask, value);
 }
 
-int
-mraa_raspberry_pi_mmap_read(mraa_gpio_context dev)
+static mraa_result_t
+mraa_raspberry_pi_mmap_bank_read(unsigned int bank, uint32_t* value)
 {
-    uint32_t value = *(volatile uint32_t*) (mmap_reg + BCM2835_GPLEV0 + (dev->pin / 32) * 4);
-    if (value & (uint32_t)(1 << (dev->pin % 32))) {
-        return 1;
-    }
-    return 0;
+    return mraa_mmap_soc_bank_read(gpio_soc, &gpio_region, bank, value);
+}
+
+static mraa_result_t
+mraa_raspberry_pi_mmap_bank_setup(unsigned int bank, mraa_boolean_t en)
+{
+    return mraa_mmap_soc_bank_setup(gpio_soc, &gpio_region, bank, en);
 }
 
 mraa_result_t
@@ -163,11 +143,7 @@ mraa_raspberry_pi_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_raspberry_pi_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(&gpio_region);
     }
 
     if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
@@ -175,32 +151,12 @@ mraa_raspberry_pi_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    // Might need to make some elements of this thread safe.
-    // For example only allow one thread to enter the following block
-    // to prevent mmap'ing twice.
-    if (mmap_reg == NULL) {
-        if ((mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "raspberry map: unable to open resource0 file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-
-        if (platform_detected == PLATFORM_RASPBERRY_PI2_B_REV_1) {
-            mmap_reg = (uint8_t*) mmap(NULL, BCM2836_BLOCK_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, BCM2836_GPIO_BASE);
-        } else {
-            mmap_reg = (uint8_t*) mmap(NULL, BCM2835_BLOCK_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, BCM2835_GPIO_BASE);
-        }
-        if (mmap_reg == MAP_FAILED) {
-            syslog(LOG_ERR, "raspberry mmap: failed to mmap");
-            mmap_reg = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    if (mraa_mmap_acquire(&gpio_region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "raspberry mmap: failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     dev->mmap_write = &mraa_raspberry_pi_mmap_write;
     dev->mmap_read = &mraa_raspberry_pi_mmap_read;
-    mmap_count++;
 
     return MRAA_SUCCESS;
 }
@@ -250,6 +206,7 @@ mraa_raspberry_pi()
                     b->platform_name = PLATFORM_NAME_RASPBERRY_PI2_B_REV_1;
                     platform_detected = PLATFORM_RASPBERRY_PI2_B_REV_1;
                     b->phy_pin_count = MRAA_RASPBERRY_PI2_B_REV_1_PINCOUNT;
+                    gpio_soc = &mraa_mmap_soc_bcm2836;
                 } else {
                     b->platform_name = PLATFORM_NAME_RASPBERRY_PI_B_REV_1;
                     platform_detected = PLATFORM_RASPBERRY_PI_B_REV_1;
@@ -289,7 +246,11 @@ mraa_raspberry_pi()
 
     b->adv_func->spi_init_pre = &mraa_raspberry_pi_spi_init_pre;
     b->adv_func->i2c_init_pre = &mraa_raspberry_pi_i2c_init_pre;
+    mraa_mmap_soc_regions(gpio_soc, &gpio_region);
     b->adv_func->gpio_mmap_setup = &mraa_raspberry_pi_mmap_setup;
+    b->adv_func->gpio_mmap_bank_write = &mraa_raspberry_pi_mmap_bank_write;
+    b->adv_func->gpio_mmap_bank_read = &mraa_raspberry_pi_mmap_bank_read;
+    b->adv_func->gpio_mmap_bank_setup = &mraa_raspberry_pi_mmap_bank_setup;
 
     strncpy(b->pins[0].name, "INVALID", MRAA_PIN_NAME_SIZE);
     b->pins[0].capabilites = (mraa_pincapabilities_t){ 0, 0, 0, 0, 0, 0, 0, 0 };
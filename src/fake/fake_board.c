@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "common.h"
+#include "fake/fake_board.h"
+#include "mmap/mmap_soc.h"
+
+#define PLATFORM_NAME "Fake sysfs platform"
+#define UART_DEV_PATH "/dev/ttyFAKE0"
+
+static char uart_path[PATH_MAX];
+static const mraa_mmap_soc_t* fake_soc = NULL;
+static mraa_mmap_region_t gpio_region[MRAA_MMAP_SOC_BLOCKS];
+
+static void
+mraa_fake_pin(mraa_board_t* b, int pin, const char* name, mraa_pincapabilities_t caps)
+{
+    strncpy(b->pins[pin].name, name, MRAA_PIN_NAME_SIZE);
+    b->pins[pin].capabilites = caps;
+}
+
+static mraa_result_t
+mraa_fake_mmap_write(mraa_gpio_context dev, int value)
+{
+    return mraa_mmap_soc_gpio_write(fake_soc, gpio_region, dev->pin, value);
+}
+
+static int
+mraa_fake_mmap_read(mraa_gpio_context dev)
+{
+    return mraa_mmap_soc_gpio_read(fake_soc, gpio_region, dev->pin);
+}
+
+static mraa_result_t
+mraa_fake_mmap_bank_write(unsigned int bank, uint32_t mask, uint32_t value)
+{
+    return mraa_mmap_soc_bank_write(fake_soc, gpio_region, bank, mask, value);
+}
+
+static mraa_result_t
+mraa_fake_mmap_bank_read(unsigned int bank, uint32_t* value)
+{
+    return mraa_mmap_soc_bank_read(fake_soc, gpio_region, bank, value);
+}
+
+static mraa_result_t
+mraa_fake_mmap_bank_setup(unsigned int bank, mraa_boolean_t en)
+{
+    return mraa_mmap_soc_bank_setup(fake_soc, gpio_region, bank, en);
+}
+
+static mraa_result_t
+mraa_fake_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "fake mmap: context not valid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    mraa_mmap_region_t* region = mraa_mmap_soc_block(fake_soc, gpio_region, dev->pin);
+    if (region == NULL) {
+        syslog(LOG_ERR, "fake mmap: gpio%d not on %s", dev->pin, fake_soc->name);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (en == 0) {
+        if (dev->mmap_write == NULL && dev->mmap_read == NULL) {
+            syslog(LOG_ERR, "fake mmap: can't disable disabled mmap gpio");
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+        dev->mmap_write = NULL;
+        dev->mmap_read = NULL;
+        return mraa_mmap_release(region);
+    }
+
+    if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
+        syslog(LOG_ERR, "fake mmap: can't enable enabled mmap gpio");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (mraa_mmap_acquire(region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "fake mmap: failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    dev->mmap_write = &mraa_fake_mmap_write;
+    dev->mmap_read = &mraa_fake_mmap_read;
+
+    return MRAA_SUCCESS;
+}
+
+/**
+ * Emulate the gpio registers of a SoC. The registers are always simulated,
+ * MRAA_MMAP_SIM only chooses between memory and a directory of files.
+ */
+static mraa_result_t
+mraa_fake_soc(mraa_board_t* b, const char* name)
+{
+    fake_soc = mraa_mmap_soc_find(name);
+    if (fake_soc == NULL) {
+        syslog(LOG_ERR, "fake: no register layout for soc %s", name);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    const char* backing = getenv("MRAA_MMAP_SIM");
+    if (backing != NULL && (strcmp(backing, "0") == 0 || strcmp(backing, "1") == 0)) {
+        backing = NULL;
+    }
+    if (mraa_mmap_simulate(backing) != MRAA_SUCCESS) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    mraa_mmap_soc_regions(fake_soc, gpio_region);
+    b->adv_func->gpio_mmap_setup = &mraa_fake_mmap_setup;
+    b->adv_func->gpio_mmap_bank_write = &mraa_fake_mmap_bank_write;
+    b->adv_func->gpio_mmap_bank_read = &mraa_fake_mmap_bank_read;
+    b->adv_func->gpio_mmap_bank_setup = &mraa_fake_mmap_bank_setup;
+    syslog(LOG_NOTICE, "fake: emulating %s gpio registers", fake_soc->name);
+    return MRAA_SUCCESS;
+}
+
+mraa_platform_t
+mraa_fake_platform(const char* root)
+{
+    int i;
+
+    if (mraa_set_sysfs_root(root) != MRAA_SUCCESS) {
+        return MRAA_UNKNOWN_PLATFORM;
+    }
+
+    mraa_board_t* b = (mraa_board_t*) calloc(1, sizeof(mraa_board_t));
+    if (b == NULL) {
+        goto error;
+    }
+
+    b->platform_name = PLATFORM_NAME;
+    b->phy_pin_count = MRAA_FAKE_PINCOUNT;
+    b->gpio_count = MRAA_FAKE_GPIO_COUNT;
+    b->aio_count = MRAA_FAKE_AIO_COUNT;
+    b->adc_raw = 12;
+    b->adc_supported = 10;
+    b->pwm_default_period = 5000;
+    b->pwm_max_period = 218453;
+    b->pwm_min_period = 1;
+
+    b->adv_func = (mraa_adv_func_t*) calloc(1, sizeof(mraa_adv_func_t));
+    if (b->adv_func == NULL) {
+        goto error;
+    }
+
+    b->pins = (mraa_pininfo_t*) calloc(MRAA_FAKE_PINCOUNT, sizeof(mraa_pininfo_t));
+    if (b->pins == NULL) {
+        free(b->adv_func);
+        goto error;
+    }
+
+    char name[MRAA_PIN_NAME_SIZE];
+    for (i = 0; i < 8; i++) {
+        snprintf(name, MRAA_PIN_NAME_SIZE, "GPIO%d", i);
+        mraa_fake_pin(b, i, name, (mraa_pincapabilities_t){ 1, 1, 0, 0, 0, 0, 0, 0 });
+        b->pins[i].gpio.pinmap = i;
+    }
+    for (i = 8; i < 10; i++) {
+        snprintf(name, MRAA_PIN_NAME_SIZE, "PWM%d", i - 8);
+        mraa_fake_pin(b, i, name, (mraa_pincapabilities_t){ 1, 1, 1, 0, 0, 0, 0, 0 });
+        b->pins[i].gpio.pinmap = i;
+        b->pins[i].pwm.parent_id = 0;
+        b->pins[i].pwm.pinmap = i - 8;
+    }
+
+    mraa_fake_pin(b, 10, "I2C0SDA", (mraa_pincapabilities_t){ 1, 0, 0, 0, 0, 1, 0, 0 });
+    mraa_fake_pin(b, 11, "I2C0SCL", (mraa_pincapabilities_t){ 1, 0, 0, 0, 0, 1, 0, 0 });
+    b->i2c_bus_count = 1;
+    b->def_i2c_bus = 0;
+    b->i2c_bus[0].bus_id = 0;
+    b->i2c_bus[0].sda = 10;
+    b->i2c_bus[0].scl = 11;
+
+    mraa_fake_pin(b, 12, "SPI0CLK", (mraa_pincapabilities_t){ 1, 0, 0, 0, 1, 0, 0, 0 });
+    mraa_fake_pin(b, 13, "SPI0MOSI", (mraa_pincapabilities_t){ 1, 0, 0, 0, 1, 0, 0, 0 });
+    mraa_fake_pin(b, 14, "SPI0MISO", (mraa_pincapabilities_t){ 1, 0, 0, 0, 1, 0, 0, 0 });
+    mraa_fake_pin(b, 15, "SPI0CS0", (mraa_pincapabilities_t){ 1, 0, 0, 0, 1, 0, 0, 0 });
+    b->spi_bus_count = 1;
+    b->def_spi_bus = 0;
+    b->spi_bus[0].bus_id = 0;
+    b->spi_bus[0].slave_s = 0;
+    b->spi_bus[0].sclk = 12;
+    b->spi_bus[0].mosi = 13;
+    b->spi_bus[0].miso = 14;
+    b->spi_bus[0].cs = 15;
+
+    mraa_fake_pin(b, 16, "UART0RX", (mraa_pincapabilities_t){ 1, 0, 0, 0, 0, 0, 0, 1 });
+    mraa_fake_pin(b, 17, "UART0TX", (mraa_pincapabilities_t){ 1, 0, 0, 0, 0, 0, 0, 1 });
+    if (mraa_sysfs_path(uart_path, sizeof(uart_path), UART_DEV_PATH) >= (int) sizeof(uart_path)) {
+        syslog(LOG_ERR, "fake: root %s is too long", root);
+        free(b->pins);
+        free(b->adv_func);
+        goto error;
+    }
+    b->uart_dev_count = 1;
+    b->def_uart_dev = 0;
+    b->uart_dev[0].index = 0;
+    b->uart_dev[0].rx = 16;
+    b->uart_dev[0].tx = 17;
+    b->uart_dev[0].device_path = uart_path;
+
+    for (i = 0; i < MRAA_FAKE_AIO_COUNT; i++) {
+        snprintf(name, MRAA_PIN_NAME_SIZE, "A%d", i);
+        mraa_fake_pin(b, MRAA_FAKE_GPIO_COUNT + i, name, (mraa_pincapabilities_t){ 1, 0, 0, 0, 0, 0, 1, 0 });
+        b->pins[MRAA_FAKE_GPIO_COUNT + i].aio.pinmap = i;
+    }
+
+    const char* soc = getenv("MRAA_FAKE_SOC");
+    if (soc != NULL && soc[0] != '\0' && mraa_fake_soc(b, soc) != MRAA_SUCCESS) {
+        free(b->pins);
+        free(b->adv_func);
+        goto error;
+    }
+
+    plat = b;
+    syslog(LOG_NOTICE, "fake: sysfs and devfs redirected to %s", root);
+    return MRAA_FAKE_PLATFORM;
+
+error:
+    syslog(LOG_CRIT, "fake: Platform failed to initialise");
+    free(b);
+    mraa_set_sysfs_root(NULL);
+    return MRAA_UNKNOWN_PLATFORM;
+}
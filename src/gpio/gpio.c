@@ -24,6 +24,8 @@
  */
 #include "gpio.h"
 #include "mraa_internal.h"
+#include "gpio/gpio_chardev.h"
+#include "gpio/gpio_dispatch.h"
 
 #include <stdlib.h>
 #include <fcntl.h>
@@ -36,14 +38,16 @@
 #include <sys/mman.h>
 
 #define SYSFS_CLASS_GPIO "/sys/class/gpio"
-#define MAX_SIZE 64
+#define MAX_SIZE 128
 #define POLL_TIMEOUT
+// largest event queue, 2^20 events
+#define MAX_EVENT_QUEUE (1u << 20)
 
 static mraa_result_t
 mraa_gpio_get_valfp(mraa_gpio_context dev)
 {
     char bu[MAX_SIZE];
-    sprintf(bu, SYSFS_CLASS_GPIO "/gpio%d/value", dev->pin);
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", dev->pin);
     dev->value_fp = open(bu, O_RDWR);
     if (dev->value_fp == -1) {
         return MRAA_ERROR_INVALID_RESOURCE;
@@ -70,14 +74,14 @@ mraa_gpio_init_internal(mraa_adv_func_t* func_table, int pin)
 
     dev->advance_func = func_table;
     dev->pin = pin;
-
-    if (IS_FUNC_DEFINED(dev, gpio_init_internal_replace)) {
-        status = dev->advance_func->gpio_init_internal_replace(pin);
-        if (status == MRAA_SUCCESS)
-            return dev;
-        else
-            goto init_internal_cleanup;
-    }
+    dev->value_fp = -1;
+    dev->isr_value_fp = -1;
+    dev->phy_pin = -1;
+    dev->chip_fd = -1;
+    dev->line_fd = -1;
+    mraa_sysfs_attr_init(&dev->direction);
+    mraa_sysfs_attr_init(&dev->edge);
+    mraa_sysfs_attr_init(&dev->drive);
 
     if (IS_FUNC_DEFINED(dev, gpio_init_pre)) {
         status = dev->advance_func->gpio_init_pre(pin);
@@ -85,18 +89,20 @@ mraa_gpio_init_internal(mraa_adv_func_t* func_table, int pin)
             goto init_internal_cleanup;
     }
 
-    dev->value_fp = -1;
-    dev->isr_value_fp = -1;
-    dev->phy_pin = -1;
+    if (IS_FUNC_DEFINED(dev, gpio_init_internal_replace)) {
+        status = dev->advance_func->gpio_init_internal_replace(dev, pin);
+        goto init_internal_cleanup;
+    }
 
     // then check to make sure the pin is exported.
     char directory[MAX_SIZE];
-    snprintf(directory, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/", dev->pin);
+    mraa_sysfs_path(directory, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/", dev->pin);
     struct stat dir;
     if (stat(directory, &dir) == 0 && S_ISDIR(dir.st_mode)) {
         dev->owner = 0; // Not Owner
     } else {
-        int export = open(SYSFS_CLASS_GPIO "/export", O_WRONLY);
+        mraa_sysfs_path(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/export");
+        int export = open(bu, O_WRONLY);
         if (export == -1) {
             syslog(LOG_ERR, "gpio: Failed to open export for writing");
             status = MRAA_ERROR_NO_RESOURCES;
@@ -121,11 +127,12 @@ init_internal_cleanup:
             free(dev);
         return NULL;
     }
+    mraa_mux_track_open(dev);
     return dev;
 }
 
-mraa_gpio_context
-mraa_gpio_init(int pin)
+static mraa_gpio_context
+mraa_gpio_init_board(int pin, mraa_boolean_t chardev)
 {
     mraa_board_t* board = plat;
     if (board == NULL) {
@@ -158,7 +165,15 @@ mraa_gpio_init(int pin)
         }
     }
 
-    mraa_gpio_context r = mraa_gpio_init_internal(board->adv_func, board->pins[pin].gpio.pinmap);
+    mraa_adv_func_t* func_table = board->adv_func;
+    if (chardev) {
+        func_table = mraa_gpio_chardev_func_table(board->adv_func);
+        if (func_table == NULL) {
+            return NULL;
+        }
+    }
+
+    mraa_gpio_context r = mraa_gpio_init_internal(func_table, board->pins[pin].gpio.pinmap);
     if (r == NULL) {
         syslog(LOG_CRIT, "gpio: mraa_gpio_init_raw(%d) returned error", pin);
         return NULL;
@@ -168,22 +183,44 @@ mraa_gpio_init(int pin)
     if (IS_FUNC_DEFINED(r, gpio_init_post)) {
         mraa_result_t ret = r->advance_func->gpio_init_post(r);
         if (ret != MRAA_SUCCESS) {
-            free(r);
+            mraa_gpio_close(r);
             return NULL;
         }
     }
     return r;
 }
 
+mraa_gpio_context
+mraa_gpio_init(int pin)
+{
+    return mraa_gpio_init_board(pin, 0);
+}
+
 mraa_gpio_context
 mraa_gpio_init_raw(int pin)
 {
     return mraa_gpio_init_internal(plat == NULL ? NULL : plat->adv_func , pin);
 }
 
+mraa_gpio_context
+mraa_gpio_init_chardev(int pin)
+{
+    return mraa_gpio_init_board(pin, 1);
+}
+
+mraa_gpio_context
+mraa_gpio_init_chardev_raw(int pin)
+{
+    mraa_adv_func_t* func_table = mraa_gpio_chardev_func_table(plat == NULL ? NULL : plat->adv_func);
+    if (func_table == NULL) {
+        return NULL;
+    }
+    return mraa_gpio_init_internal(func_table, pin);
+}
+
 
 static mraa_result_t
-mraa_gpio_wait_interrupt(int fd)
+mraa_gpio_wait_interrupt(int fd, int timeout_ms, int* value)
 {
     unsigned char c;
     struct pollfd pfd;
@@ -200,16 +237,55 @@ mraa_gpio_wait_interrupt(int fd)
     lseek(fd, 0, SEEK_SET);
     read(fd, &c, 1);
 
-    // Wait for it forever or until pthread_cancel
+    // Wait for it until timeout or pthread_cancel
     // poll is a cancelable point like sleep()
-    int x = poll(&pfd, 1, -1);
+    int x = poll(&pfd, 1, timeout_ms);
+    if (x < 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (x == 0) {
+        return MRAA_ERROR_NO_DATA_AVAILABLE;
+    }
 
     // do a final read to clear interrupt
-    read(fd, &c, 1);
+    lseek(fd, 0, SEEK_SET);
+    if (read(fd, &c, 1) == 1 && value != NULL) {
+        *value = c == '1';
+    }
 
     return MRAA_SUCCESS;
 }
 
+void
+mraa_gpio_isr_call(mraa_gpio_context dev)
+{
+#ifdef SWIGPYTHON
+    // In order to call a python object (all python functions are objects) we
+    // need to aquire the GIL (Global Interpreter Lock). This may not always be
+    // nessecary but especially if doing IO (like print()) python will segfault
+    // if we do not hold a lock on the GIL
+    PyGILState_STATE gilstate = PyGILState_Ensure();
+    PyObject* arglist;
+    PyObject* ret;
+    arglist = Py_BuildValue("(i)", dev->isr_args);
+    if (arglist == NULL) {
+        syslog(LOG_ERR, "gpio: Py_BuildValue NULL");
+    } else {
+        ret = PyEval_CallObject((PyObject*) dev->isr, arglist);
+        if (ret == NULL) {
+            syslog(LOG_ERR, "gpio: PyEval_CallObject failed");
+        } else {
+            Py_DECREF(ret);
+        }
+        Py_DECREF(arglist);
+    }
+
+    PyGILState_Release(gilstate);
+#else
+    dev->isr(dev->isr_args);
+#endif
+}
+
 static void*
 mraa_gpio_interrupt_handler(void* arg)
 {
@@ -219,51 +295,35 @@ mraa_gpio_interrupt_handler(void* arg)
 
     mraa_result_t ret;
 
-    // open gpio value with open(3)
-    char bu[MAX_SIZE];
-    sprintf(bu, SYSFS_CLASS_GPIO "/gpio%d/value", dev->pin);
-    int fp = open(bu, O_RDONLY);
-    if (fp < 0) {
-        syslog(LOG_ERR, "gpio: failed to open gpio%d/value", dev->pin);
-        return NULL;
+    if (!IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace)) {
+        // open gpio value with open(3)
+        char bu[MAX_SIZE];
+        mraa_sysfs_path(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", dev->pin);
+        int fp = open(bu, O_RDONLY);
+        if (fp < 0) {
+            syslog(LOG_ERR, "gpio: failed to open gpio%d/value", dev->pin);
+            return NULL;
+        }
+        dev->isr_value_fp = fp;
     }
-    dev->isr_value_fp = fp;
 
     for (;;) {
-        ret = mraa_gpio_wait_interrupt(dev->isr_value_fp);
+        if (IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace)) {
+            ret = dev->advance_func->gpio_wait_interrupt_replace(dev, -1, NULL);
+        } else {
+            ret = mraa_gpio_wait_interrupt(dev->isr_value_fp, -1, NULL);
+        }
         if (ret == MRAA_SUCCESS) {
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-#ifdef SWIGPYTHON
-            // In order to call a python object (all python functions are objects) we
-            // need to aquire the GIL (Global Interpreter Lock). This may not always be
-            // nessecary but especially if doing IO (like print()) python will segfault
-            // if we do not hold a lock on the GIL
-            PyGILState_STATE gilstate = PyGILState_Ensure();
-            PyObject* arglist;
-            PyObject* ret;
-            arglist = Py_BuildValue("(i)", dev->isr_args);
-            if (arglist == NULL) {
-                syslog(LOG_ERR, "gpio: Py_BuildValue NULL");
-            } else {
-                ret = PyEval_CallObject((PyObject*) dev->isr, arglist);
-                if (ret == NULL) {
-                    syslog(LOG_ERR, "gpio: PyEval_CallObject failed");
-                } else {
-                    Py_DECREF(ret);
-                }
-                Py_DECREF(arglist);
-            }
-
-            PyGILState_Release(gilstate);
-#else
-            dev->isr(dev->isr_args);
-#endif
+            mraa_gpio_isr_call(dev);
             pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
         } else {
             // we must have got an error code so die nicely
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-            close(dev->isr_value_fp);
-            dev->isr_value_fp = -1;
+            if (dev->isr_value_fp != -1) {
+                close(dev->isr_value_fp);
+                dev->isr_value_fp = -1;
+            }
             return NULL;
         }
     }
@@ -275,19 +335,8 @@ mraa_gpio_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
     if (IS_FUNC_DEFINED(dev, gpio_edge_mode_replace))
         return dev->advance_func->gpio_edge_mode_replace(dev, mode);
 
-    if (dev->value_fp != -1) {
-        close(dev->value_fp);
-        dev->value_fp = -1;
-    }
-
     char filepath[MAX_SIZE];
-    snprintf(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/edge", dev->pin);
-
-    int edge = open(filepath, O_RDWR);
-    if (edge == -1) {
-        syslog(LOG_ERR, "gpio: Failed to open edge for writing");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
+    mraa_sysfs_path(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/edge", dev->pin);
 
     char bu[MAX_SIZE];
     int length;
@@ -305,16 +354,13 @@ mraa_gpio_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
             length = snprintf(bu, sizeof(bu), "falling");
             break;
         default:
-            close(edge);
             return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
     }
-    if (write(edge, bu, length * sizeof(char)) == -1) {
+    if (mraa_sysfs_attr_write(&dev->edge, filepath, bu, length, 1) != MRAA_SUCCESS) {
         syslog(LOG_ERR, "gpio: Failed to write to edge");
-        close(edge);
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    close(edge);
     return MRAA_SUCCESS;
 }
 
@@ -322,7 +368,7 @@ mraa_result_t
 mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t mode, void (*fptr)(void*), void* args)
 {
     // we only allow one isr per mraa_gpio_context
-    if (dev->thread_id != 0) {
+    if (dev->thread_id != 0 || dev->isr_dispatched) {
         return MRAA_ERROR_NO_RESOURCES;
     }
 
@@ -332,21 +378,200 @@ mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t mode, void (*fptr)(void*),
 
     dev->isr = fptr;
     dev->isr_args = args;
-    pthread_create(&dev->thread_id, NULL, mraa_gpio_interrupt_handler, (void*) dev);
 
+    // platforms that wait in their own way keep a thread per context, sysfs
+    // and gpiochip events share the dispatcher threads
+    if (IS_FUNC_DEFINED(dev, gpio_interrupt_handler_replace)) {
+        pthread_create(&dev->thread_id, NULL, mraa_gpio_interrupt_handler, (void*) dev);
+        return MRAA_SUCCESS;
+    }
+    if (dev->line_fd != -1 && dev->line_eventflags != 0) {
+        if (mraa_gpio_dispatch_add(dev, dev->line_fd, 1) != MRAA_SUCCESS) {
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+        dev->isr_dispatched = 1;
+        return MRAA_SUCCESS;
+    }
+    if (IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace)) {
+        pthread_create(&dev->thread_id, NULL, mraa_gpio_interrupt_handler, (void*) dev);
+        return MRAA_SUCCESS;
+    }
+
+    char bu[MAX_SIZE];
+    unsigned char c;
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", dev->pin);
+    dev->isr_value_fp = open(bu, O_RDONLY);
+    if (dev->isr_value_fp < 0) {
+        syslog(LOG_ERR, "gpio: failed to open gpio%d/value", dev->pin);
+        dev->isr_value_fp = -1;
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    // do an initial read to clear interrupt
+    read(dev->isr_value_fp, &c, 1);
+    if (mraa_gpio_dispatch_add(dev, dev->isr_value_fp, 0) != MRAA_SUCCESS) {
+        close(dev->isr_value_fp);
+        dev->isr_value_fp = -1;
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    dev->isr_dispatched = 1;
+
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_gpio_wait_edge(mraa_gpio_context dev, int timeout_ms)
+{
+    mraa_result_t ret;
+    int value = -1;
+
+    if (dev == NULL) {
+        return -1;
+    }
+    // an isr would race us for the edge
+    if (dev->thread_id != 0 || dev->isr_dispatched || IS_FUNC_DEFINED(dev, gpio_interrupt_handler_replace)) {
+        return -1;
+    }
+
+    if (IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace)) {
+        ret = dev->advance_func->gpio_wait_interrupt_replace(dev, timeout_ms, &value);
+    } else {
+        if (dev->value_fp == -1 && mraa_gpio_get_valfp(dev) != MRAA_SUCCESS) {
+            return -1;
+        }
+        ret = mraa_gpio_wait_interrupt(dev->value_fp, timeout_ms, &value);
+    }
+
+    if (ret == MRAA_ERROR_NO_DATA_AVAILABLE) {
+        return -2;
+    }
+    if (ret != MRAA_SUCCESS) {
+        return -1;
+    }
+    return value;
+}
+
+mraa_result_t
+mraa_gpio_isr_priority(mraa_gpio_context dev, int priority)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    dev->isr_priority = priority;
     return MRAA_SUCCESS;
 }
 
+mraa_result_t
+mraa_gpio_isr_threads(unsigned int num_threads)
+{
+    return mraa_gpio_dispatch_threads(num_threads);
+}
+
+mraa_result_t
+mraa_gpio_isr_poll(mraa_gpio_context dev, int cpu)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (dev->thread_id != 0 || dev->isr_dispatched) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    if (!IS_FUNC_DEFINED(dev, gpio_isr_poll_setup)) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    return dev->advance_func->gpio_isr_poll_setup(dev, cpu);
+}
+
+mraa_result_t
+mraa_gpio_events(mraa_gpio_context dev, mraa_gpio_edge_t edge, unsigned int queue_size)
+{
+    unsigned int size = 256;
+
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (dev->thread_id != 0 || dev->isr_dispatched) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    // only the dispatcher knows how to queue events
+    if (IS_FUNC_DEFINED(dev, gpio_interrupt_handler_replace) ||
+        (IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace) && dev->chip_fd == -1)) {
+        return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+
+    if (queue_size > MAX_EVENT_QUEUE) {
+        syslog(LOG_ERR, "gpio: events: queue of %u events above the %u maximum", queue_size, MAX_EVENT_QUEUE);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    if (queue_size != 0) {
+        for (size = 2; size < queue_size; size <<= 1)
+            ;
+    }
+    mraa_gpio_event_ring_t* ring = (mraa_gpio_event_ring_t*) calloc(1, sizeof(mraa_gpio_event_ring_t));
+    if (ring == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    ring->buf = (mraa_gpio_event_t*) calloc(size, sizeof(mraa_gpio_event_t));
+    if (ring->buf == NULL) {
+        free(ring);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    ring->size = size;
+
+    dev->events = ring;
+    mraa_result_t ret = mraa_gpio_isr(dev, edge, NULL, NULL);
+    if (ret != MRAA_SUCCESS) {
+        dev->events = NULL;
+        free(ring->buf);
+        free(ring);
+    }
+    return ret;
+}
+
+int
+mraa_gpio_read_events(mraa_gpio_context dev, mraa_gpio_event_t* buf, int max)
+{
+    if (dev == NULL || dev->events == NULL || buf == NULL || max < 0) {
+        return -1;
+    }
+    return mraa_gpio_event_ring_pop(dev->events, buf, max);
+}
+
+unsigned int
+mraa_gpio_events_dropped(mraa_gpio_context dev)
+{
+    if (dev == NULL || dev->events == NULL) {
+        return 0;
+    }
+    return __atomic_load_n(&dev->events->dropped, __ATOMIC_RELAXED);
+}
+
 mraa_result_t
 mraa_gpio_isr_exit(mraa_gpio_context dev)
 {
     mraa_result_t ret = MRAA_SUCCESS;
 
     // wasting our time, there is no isr to exit from
-    if (dev->thread_id == 0 && dev->isr_value_fp == -1) {
+    if (dev->thread_id == 0 && dev->isr_value_fp == -1 && !dev->isr_dispatched) {
         return ret;
     }
 
+    // has to happen before the edge mode change, which can close the fd
+    if (dev->isr_dispatched) {
+        if (mraa_gpio_dispatch_remove(dev) != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "gpio: gpio%d was not registered with the dispatcher", dev->pin);
+        }
+        dev->isr_dispatched = 0;
+    }
+    if (dev->events != NULL) {
+        free(dev->events->buf);
+        free(dev->events);
+        dev->events = NULL;
+    }
+    if (dev->capture != NULL) {
+        mraa_gpio_capture_free(dev->capture);
+        dev->capture = NULL;
+    }
+
     // stop isr being useful
     ret = mraa_gpio_edge_mode(dev, MRAA_GPIO_EDGE_NONE);
 
@@ -381,19 +606,8 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
             return pre_ret;
     }
 
-    if (dev->value_fp != -1) {
-        close(dev->value_fp);
-        dev->value_fp = -1;
-    }
-
     char filepath[MAX_SIZE];
-    snprintf(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/drive", dev->pin);
-
-    int drive = open(filepath, O_WRONLY);
-    if (drive == -1) {
-        syslog(LOG_ERR, "gpio: Failed to open drive for writing");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
+    mraa_sysfs_path(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/drive", dev->pin);
 
     char bu[MAX_SIZE];
     int length;
@@ -411,16 +625,13 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
             length = snprintf(bu, sizeof(bu), "hiz");
             break;
         default:
-            close(drive);
             return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
     }
-    if (write(drive, bu, length * sizeof(char)) == -1) {
+    if (mraa_sysfs_attr_write(&dev->drive, filepath, bu, length, 1) != MRAA_SUCCESS) {
         syslog(LOG_ERR, "gpio: Failed to write to drive mode");
-        close(drive);
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    close(drive);
     if (IS_FUNC_DEFINED(dev, gpio_mode_post))
         return dev->advance_func->gpio_mode_post(dev, mode);
     return MRAA_SUCCESS;
@@ -443,27 +654,8 @@ mraa_gpio_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
     if (dev == NULL) {
         return MRAA_ERROR_INVALID_HANDLE;
     }
-    if (dev->value_fp != -1) {
-        close(dev->value_fp);
-        dev->value_fp = -1;
-    }
     char filepath[MAX_SIZE];
-    snprintf(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/direction", dev->pin);
-
-    int direction = open(filepath, O_RDWR);
-
-    if (direction == -1) {
-        // Direction Failed to Open. If HIGH or LOW was passed will try and set
-        // If not fail as usual.
-        switch (dir) {
-            case MRAA_GPIO_OUT_HIGH:
-                return mraa_gpio_write(dev, 1);
-            case MRAA_GPIO_OUT_LOW:
-                return mraa_gpio_write(dev, 0);
-            default:
-                return MRAA_ERROR_INVALID_RESOURCE;
-        }
-    }
+    mraa_sysfs_path(filepath, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/direction", dev->pin);
 
     char bu[MAX_SIZE];
     int length;
@@ -481,16 +673,27 @@ mraa_gpio_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
             length = snprintf(bu, sizeof(bu), "low");
             break;
         default:
-            close(direction);
             return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
     }
 
-    if (write(direction, bu, length * sizeof(char)) == -1) {
-        close(direction);
+    // high and low also set the value, which may have changed since
+    mraa_boolean_t cache = dir == MRAA_GPIO_OUT || dir == MRAA_GPIO_IN;
+    if (mraa_sysfs_attr_write(&dev->direction, filepath, bu, length, cache) != MRAA_SUCCESS) {
+        if (dev->direction.fd == -1) {
+            // Direction Failed to Open. If HIGH or LOW was passed will try and set
+            // If not fail as usual.
+            switch (dir) {
+                case MRAA_GPIO_OUT_HIGH:
+                    return mraa_gpio_write(dev, 1);
+                case MRAA_GPIO_OUT_LOW:
+                    return mraa_gpio_write(dev, 0);
+                default:
+                    break;
+            }
+        }
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    close(direction);
     if (IS_FUNC_DEFINED(dev, gpio_dir_post))
         return dev->advance_func->gpio_dir_post(dev, dir);
     return MRAA_SUCCESS;
@@ -533,6 +736,9 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
     if (dev == NULL)
         return MRAA_ERROR_INVALID_HANDLE;
 
+    if (IS_FUNC_DEFINED(dev, gpio_write_replace))
+        return dev->advance_func->gpio_write_replace(dev, value);
+
     if (dev->mmap_write != NULL)
         return dev->mmap_write(dev, value);
 
@@ -548,13 +754,9 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
         }
     }
 
-    if (lseek(dev->value_fp, 0, SEEK_SET) == -1) {
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-
     char bu[MAX_SIZE];
     int length = snprintf(bu, sizeof(bu), "%d", value);
-    if (write(dev->value_fp, bu, length * sizeof(char)) == -1) {
+    if (mraa_sysfs_pwrite(dev->value_fp, bu, length * sizeof(char)) == -1) {
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
@@ -566,13 +768,14 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
 static mraa_result_t
 mraa_gpio_unexport_force(mraa_gpio_context dev)
 {
-    int unexport = open(SYSFS_CLASS_GPIO "/unexport", O_WRONLY);
+    char bu[MAX_SIZE];
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/unexport");
+    int unexport = open(bu, O_WRONLY);
     if (unexport == -1) {
         syslog(LOG_ERR, "gpio: Failed to open unexport for writing");
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    char bu[MAX_SIZE];
     int length = snprintf(bu, sizeof(bu), "%d", dev->pin);
     if (write(unexport, bu, length * sizeof(char)) == -1) {
         syslog(LOG_ERR, "gpio: Failed to write to unexport");
@@ -602,10 +805,22 @@ mraa_gpio_close(mraa_gpio_context dev)
         result = dev->advance_func->gpio_close_pre(dev);
     }
 
+    // the dispatcher must be done with the context whether we own it or not
+    mraa_gpio_isr_exit(dev);
+    mraa_mux_track_close(dev);
     if (dev->value_fp != -1) {
         close(dev->value_fp);
     }
     mraa_gpio_unexport(dev);
+    if (dev->line_fd != -1) {
+        close(dev->line_fd);
+    }
+    if (dev->chip_fd != -1) {
+        close(dev->chip_fd);
+    }
+    mraa_sysfs_attr_close(&dev->direction);
+    mraa_sysfs_attr_close(&dev->edge);
+    mraa_sysfs_attr_close(&dev->drive);
     free(dev);
     return result;
 }
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_dispatch.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#define DEFAULT_WINDOW 16
+
+static void
+mraa_gpio_capture_add(uint64_t* history, unsigned int* num, unsigned int window, uint64_t value)
+{
+    history[*num % window] = value;
+    (*num)++;
+}
+
+static uint64_t
+mraa_gpio_capture_mean(const uint64_t* history, unsigned int num, unsigned int window, uint64_t* min, uint64_t* max)
+{
+    unsigned int count = num < window ? num : window;
+    uint64_t total = 0;
+    unsigned int i;
+
+    if (count == 0) {
+        return 0;
+    }
+    if (min != NULL) {
+        *min = UINT64_MAX;
+        *max = 0;
+    }
+    for (i = 0; i < count; i++) {
+        total += history[i];
+        if (min != NULL) {
+            if (history[i] < *min) {
+                *min = history[i];
+            }
+            if (history[i] > *max) {
+                *max = history[i];
+            }
+        }
+    }
+    return total / count;
+}
+
+void
+mraa_gpio_capture_push(mraa_gpio_capture_state_t* capture, const mraa_gpio_event_t* events, int num)
+{
+    int i;
+
+    pthread_mutex_lock(&capture->lock);
+    for (i = 0; i < num; i++) {
+        uint64_t t = events[i].timestamp;
+        // only rising edges are requested when widths are not wanted
+        mraa_boolean_t rising = !(capture->flags & MRAA_CAPTURE_WIDTH) || events[i].value;
+
+        if (rising) {
+            if (capture->last_rise != 0 && t > capture->last_rise) {
+                mraa_gpio_capture_add(capture->periods, &capture->num_periods, capture->window,
+                                      t - capture->last_rise);
+            }
+            if (capture->last_fall > capture->last_rise && t > capture->last_fall) {
+                mraa_gpio_capture_add(capture->lows, &capture->num_lows, capture->window,
+                                      t - capture->last_fall);
+            }
+            capture->last_rise = t;
+        } else {
+            if (capture->last_rise != 0 && capture->last_rise >= capture->last_fall && t > capture->last_rise) {
+                mraa_gpio_capture_add(capture->highs, &capture->num_highs, capture->window,
+                                      t - capture->last_rise);
+            }
+            capture->last_fall = t;
+        }
+    }
+    pthread_mutex_unlock(&capture->lock);
+}
+
+void
+mraa_gpio_capture_free(mraa_gpio_capture_state_t* capture)
+{
+    pthread_mutex_destroy(&capture->lock);
+    free(capture->periods);
+    free(capture->highs);
+    free(capture->lows);
+    free(capture);
+}
+
+mraa_result_t
+mraa_gpio_capture_start(mraa_gpio_context dev, int flags, unsigned int window)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if ((flags & (MRAA_CAPTURE_PERIOD | MRAA_CAPTURE_WIDTH)) == 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    if (dev->thread_id != 0 || dev->isr_dispatched) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    // only the dispatcher knows how to feed a capture
+    if (IS_FUNC_DEFINED(dev, gpio_interrupt_handler_replace) ||
+        (IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace) && dev->chip_fd == -1)) {
+        return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+
+    mraa_gpio_capture_state_t* capture = (mraa_gpio_capture_state_t*) calloc(1, sizeof(mraa_gpio_capture_state_t));
+    if (capture == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    pthread_mutex_init(&capture->lock, NULL);
+    capture->flags = flags;
+    capture->window = window == 0 ? DEFAULT_WINDOW : window;
+    capture->periods = (uint64_t*) calloc(capture->window, sizeof(uint64_t));
+    capture->highs = (uint64_t*) calloc(capture->window, sizeof(uint64_t));
+    capture->lows = (uint64_t*) calloc(capture->window, sizeof(uint64_t));
+    if (capture->periods == NULL || capture->highs == NULL || capture->lows == NULL) {
+        mraa_gpio_capture_free(capture);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    dev->capture = capture;
+    mraa_result_t ret = mraa_gpio_isr(dev, (flags & MRAA_CAPTURE_WIDTH) ? MRAA_GPIO_EDGE_BOTH : MRAA_GPIO_EDGE_RISING, NULL, NULL);
+    if (ret != MRAA_SUCCESS) {
+        dev->capture = NULL;
+        mraa_gpio_capture_free(capture);
+    }
+    return ret;
+}
+
+mraa_result_t
+mraa_gpio_capture_read(mraa_gpio_context dev, mraa_gpio_capture_stats_t* stats)
+{
+    mraa_gpio_capture_state_t* capture;
+    uint64_t min = 0, max = 0;
+
+    if (dev == NULL || dev->capture == NULL || stats == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    capture = dev->capture;
+
+    pthread_mutex_lock(&capture->lock);
+    stats->periods = capture->num_periods < capture->window ? capture->num_periods : capture->window;
+    stats->period_ns = mraa_gpio_capture_mean(capture->periods, capture->num_periods, capture->window, &min, &max);
+    stats->period_min_ns = min;
+    stats->period_max_ns = max;
+    stats->widths = capture->num_highs < capture->window ? capture->num_highs : capture->window;
+    stats->high_ns = mraa_gpio_capture_mean(capture->highs, capture->num_highs, capture->window, NULL, NULL);
+    stats->low_ns = mraa_gpio_capture_mean(capture->lows, capture->num_lows, capture->window, NULL, NULL);
+    stats->last_edge_ns = capture->last_rise > capture->last_fall ? capture->last_rise : capture->last_fall;
+    pthread_mutex_unlock(&capture->lock);
+
+    stats->frequency = stats->period_ns ? 1e9 / (double) stats->period_ns : 0.0;
+    stats->duty = (stats->high_ns + stats->low_ns) ? (double) stats->high_ns / (double) (stats->high_ns + stats->low_ns) : 0.0;
+    return MRAA_SUCCESS;
+}
@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_chardev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <glob.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include "linux/gpio.h"
+
+#define MAX_GPIOCHIPS 16
+#define MAX_FUNC_TABLES 4
+#define CONSUMER_LABEL "mraa"
+
+#define GPIOHANDLE_REQUEST_BIAS_MASK                                                              \
+    (GPIOHANDLE_REQUEST_BIAS_PULL_UP | GPIOHANDLE_REQUEST_BIAS_PULL_DOWN | GPIOHANDLE_REQUEST_BIAS_DISABLE)
+
+typedef struct {
+    int base;  /**< first sysfs gpio number of the chip */
+    int ngpio; /**< number of lines on the chip */
+    int index; /**< N in /dev/gpiochipN */
+} mraa_gpiochip_range_t;
+
+static mraa_gpiochip_range_t chip_ranges[MAX_GPIOCHIPS];
+static int chip_range_count = 0;
+static pthread_once_t chip_ranges_once = PTHREAD_ONCE_INIT;
+
+static struct {
+    mraa_adv_func_t* base;
+    mraa_adv_func_t table;
+} func_tables[MAX_FUNC_TABLES];
+static int func_table_count = 0;
+static pthread_mutex_t func_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+mraa_gpiochip_sysfs_base(int index)
+{
+    char pattern[PATH_MAX];
+    glob_t results;
+    int base = -1;
+
+    // only there with CONFIG_GPIO_SYSFS, the legacy chip sits under the device
+    if (mraa_sysfs_path(pattern, sizeof(pattern), "/sys/bus/gpio/devices/gpiochip%d/gpio/gpiochip*", index) >= (int) sizeof(pattern)) {
+        return -1;
+    }
+    results.gl_pathc = 0;
+    if (glob(pattern, 0, NULL, &results) == 0 && results.gl_pathc == 1) {
+        if (sscanf(basename(results.gl_pathv[0]), "gpiochip%d", &base) != 1) {
+            base = -1;
+        }
+    }
+    globfree(&results);
+    return base;
+}
+
+static int
+mraa_gpiochip_compare(const void* a, const void* b)
+{
+    return ((const mraa_gpiochip_range_t*) a)->index - ((const mraa_gpiochip_range_t*) b)->index;
+}
+
+static void
+mraa_gpiochip_scan(void)
+{
+    char pattern[PATH_MAX];
+    glob_t results;
+    mraa_boolean_t sysfs_bases = 1;
+    int i, base;
+
+    if (mraa_sysfs_path(pattern, sizeof(pattern), "/dev/gpiochip*") >= (int) sizeof(pattern)) {
+        return;
+    }
+    results.gl_pathc = 0;
+    if (glob(pattern, 0, NULL, &results) != 0) {
+        syslog(LOG_ERR, "gpiochip: no gpiochip devices found");
+        return;
+    }
+
+    for (i = 0; i < results.gl_pathc && chip_range_count < MAX_GPIOCHIPS; i++) {
+        struct gpiochip_info info;
+        mraa_gpiochip_range_t* range = &chip_ranges[chip_range_count];
+
+        if (sscanf(basename(results.gl_pathv[i]), "gpiochip%d", &range->index) != 1) {
+            continue;
+        }
+        int fd = open(results.gl_pathv[i], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            continue;
+        }
+        memset(&info, 0, sizeof(info));
+        int ret = ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info);
+        close(fd);
+        if (ret < 0 || info.lines == 0) {
+            continue;
+        }
+        range->ngpio = info.lines;
+        range->base = mraa_gpiochip_sysfs_base(range->index);
+        if (range->base < 0) {
+            sysfs_bases = 0;
+        }
+        chip_range_count++;
+    }
+    globfree(&results);
+
+    // without the sysfs numbers, count lines across the chips in index order
+    qsort(chip_ranges, chip_range_count, sizeof(mraa_gpiochip_range_t), mraa_gpiochip_compare);
+    if (!sysfs_bases) {
+        for (i = 0, base = 0; i < chip_range_count; i++) {
+            chip_ranges[i].base = base;
+            base += chip_ranges[i].ngpio;
+        }
+    }
+}
+
+int
+mraa_gpiochip_open(int gpio, unsigned int* offset)
+{
+    char bu[PATH_MAX];
+    int i;
+
+    pthread_once(&chip_ranges_once, mraa_gpiochip_scan);
+
+    for (i = 0; i < chip_range_count; i++) {
+        if (gpio >= chip_ranges[i].base && gpio < chip_ranges[i].base + chip_ranges[i].ngpio) {
+            if (mraa_sysfs_path(bu, sizeof(bu), "/dev/gpiochip%d", chip_ranges[i].index) >= (int) sizeof(bu)) {
+                return -1;
+            }
+            int fd = open(bu, O_RDWR | O_CLOEXEC);
+            if (fd == -1) {
+                syslog(LOG_ERR, "gpiochip: Failed to open %s", bu);
+                return -1;
+            }
+            *offset = gpio - chip_ranges[i].base;
+            return fd;
+        }
+    }
+
+    syslog(LOG_ERR, "gpiochip: no gpiochip provides gpio%d", gpio);
+    return -1;
+}
+
+int
+mraa_gpiochip_request_lines(int chip_fd, const unsigned int* offsets, int num, unsigned int flags, const uint8_t* values)
+{
+    struct gpiohandle_request req;
+    int i;
+
+    if (num <= 0 || num > MRAA_GPIOCHIP_LINES_MAX) {
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    for (i = 0; i < num; i++) {
+        req.lineoffsets[i] = offsets[i];
+        if (values != NULL) {
+            req.default_values[i] = values[i] ? 1 : 0;
+        }
+    }
+    req.lines = num;
+    req.flags = flags;
+    strncpy(req.consumer_label, CONSUMER_LABEL, sizeof(req.consumer_label) - 1);
+
+    if (ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) {
+        syslog(LOG_ERR, "gpiochip: Failed to request %d line(s)", num);
+        return -1;
+    }
+    return req.fd;
+}
+
+mraa_result_t
+mraa_gpiochip_get_values(int line_fd, uint8_t* values, int num)
+{
+    struct gpiohandle_data data;
+
+    if (num <= 0 || num > MRAA_GPIOCHIP_LINES_MAX) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    memset(&data, 0, sizeof(data));
+    if (ioctl(line_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    memcpy(values, data.values, num);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpiochip_set_values(int line_fd, const uint8_t* values, int num)
+{
+    struct gpiohandle_data data;
+
+    if (num <= 0 || num > MRAA_GPIOCHIP_LINES_MAX) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    memset(&data, 0, sizeof(data));
+    memcpy(data.values, values, num);
+    if (ioctl(line_fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    return MRAA_SUCCESS;
+}
+
+static unsigned int
+mraa_gpio_chardev_dir_flags(mraa_gpio_context dev)
+{
+    struct gpioline_info info;
+
+    if (dev->line_flags & (GPIOHANDLE_REQUEST_INPUT | GPIOHANDLE_REQUEST_OUTPUT)) {
+        return dev->line_flags & (GPIOHANDLE_REQUEST_INPUT | GPIOHANDLE_REQUEST_OUTPUT);
+    }
+
+    // line was requested as-is so ask the chip which way it points
+    memset(&info, 0, sizeof(info));
+    info.line_offset = dev->line_offset;
+    if (ioctl(dev->chip_fd, GPIO_GET_LINEINFO_IOCTL, &info) < 0) {
+        return GPIOHANDLE_REQUEST_INPUT;
+    }
+    return (info.flags & GPIOLINE_FLAG_IS_OUT) ? GPIOHANDLE_REQUEST_OUTPUT : GPIOHANDLE_REQUEST_INPUT;
+}
+
+static mraa_result_t
+mraa_gpio_chardev_request(mraa_gpio_context dev, unsigned int flags, unsigned int eventflags, int value)
+{
+    uint8_t values[1] = { value ? 1 : 0 };
+
+    // a line can only be requested once so drop the current request first
+    if (dev->line_fd != -1) {
+        close(dev->line_fd);
+        dev->line_fd = -1;
+    }
+
+    if (eventflags != 0) {
+        struct gpioevent_request req;
+        memset(&req, 0, sizeof(req));
+        req.lineoffset = dev->line_offset;
+        req.handleflags = flags;
+        req.eventflags = eventflags;
+        strncpy(req.consumer_label, CONSUMER_LABEL, sizeof(req.consumer_label) - 1);
+        if (ioctl(dev->chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req) < 0) {
+            syslog(LOG_ERR, "gpiochip: Failed to request events on gpio%d", dev->pin);
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        dev->line_fd = req.fd;
+    } else {
+        dev->line_fd = mraa_gpiochip_request_lines(dev->chip_fd, &dev->line_offset, 1, flags, values);
+        if (dev->line_fd == -1) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+
+    dev->line_flags = flags;
+    dev->line_eventflags = eventflags;
+    return MRAA_SUCCESS;
+}
+
+static mraa_result_t
+mraa_gpio_chardev_init_internal_replace(mraa_gpio_context dev, int pin)
+{
+    dev->chip_fd = mraa_gpiochip_open(pin, &dev->line_offset);
+    if (dev->chip_fd == -1) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    // nothing is exported so there is nothing to unexport on close
+    dev->owner = 0;
+    if (mraa_gpio_chardev_request(dev, 0, 0, 0) != MRAA_SUCCESS) {
+        close(dev->chip_fd);
+        dev->chip_fd = -1;
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    return MRAA_SUCCESS;
+}
+
+static int
+mraa_gpio_chardev_read_replace(mraa_gpio_context dev)
+{
+    uint8_t value;
+
+    if (mraa_gpiochip_get_values(dev->line_fd, &value, 1) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "gpiochip: Failed to read gpio%d", dev->pin);
+        return -1;
+    }
+    return value;
+}
+
+static mraa_result_t
+mraa_gpio_chardev_write_replace(mraa_gpio_context dev, int value)
+{
+    uint8_t v = value ? 1 : 0;
+
+    if (dev->line_eventflags != 0 || (dev->line_flags & GPIOHANDLE_REQUEST_INPUT)) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    return mraa_gpiochip_set_values(dev->line_fd, &v, 1);
+}
+
+static mraa_result_t
+mraa_gpio_chardev_dir_replace(mraa_gpio_context dev, mraa_gpio_dir_t dir)
+{
+    unsigned int bias = dev->line_flags & GPIOHANDLE_REQUEST_BIAS_MASK;
+
+    switch (dir) {
+        case MRAA_GPIO_OUT:
+        case MRAA_GPIO_OUT_LOW:
+            return mraa_gpio_chardev_request(dev, GPIOHANDLE_REQUEST_OUTPUT | bias, 0, 0);
+        case MRAA_GPIO_OUT_HIGH:
+            return mraa_gpio_chardev_request(dev, GPIOHANDLE_REQUEST_OUTPUT | bias, 0, 1);
+        case MRAA_GPIO_IN:
+            if (dev->line_eventflags != 0) {
+                // an event request is always an input, keep watching edges
+                return MRAA_SUCCESS;
+            }
+            return mraa_gpio_chardev_request(dev, GPIOHANDLE_REQUEST_INPUT | bias, 0, 0);
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+}
+
+static mraa_result_t
+mraa_gpio_chardev_mode_replace(mraa_gpio_context dev, mraa_gpio_mode_t mode)
+{
+    unsigned int flags = mraa_gpio_chardev_dir_flags(dev);
+    int value = 0;
+
+    switch (mode) {
+        case MRAA_GPIO_STRONG:
+            break;
+        case MRAA_GPIO_PULLUP:
+            flags |= GPIOHANDLE_REQUEST_BIAS_PULL_UP;
+            break;
+        case MRAA_GPIO_PULLDOWN:
+            flags |= GPIOHANDLE_REQUEST_BIAS_PULL_DOWN;
+            break;
+        case MRAA_GPIO_HIZ:
+            flags = GPIOHANDLE_REQUEST_INPUT | GPIOHANDLE_REQUEST_BIAS_DISABLE;
+            break;
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+
+    if (flags & GPIOHANDLE_REQUEST_OUTPUT) {
+        // keep the level the pin is driving so the re-request doesn't glitch
+        value = mraa_gpio_chardev_read_replace(dev);
+        if (value < 0) {
+            value = 0;
+        }
+    }
+    return mraa_gpio_chardev_request(dev, flags, dev->line_eventflags, value);
+}
+
+static mraa_result_t
+mraa_gpio_chardev_edge_mode_replace(mraa_gpio_context dev, mraa_gpio_edge_t mode)
+{
+    unsigned int flags = GPIOHANDLE_REQUEST_INPUT | (dev->line_flags & GPIOHANDLE_REQUEST_BIAS_MASK);
+
+    switch (mode) {
+        case MRAA_GPIO_EDGE_NONE:
+            if (dev->line_eventflags == 0) {
+                return MRAA_SUCCESS;
+            }
+            return mraa_gpio_chardev_request(dev, flags, 0, 0);
+        case MRAA_GPIO_EDGE_BOTH:
+            return mraa_gpio_chardev_request(dev, flags, GPIOEVENT_REQUEST_BOTH_EDGES, 0);
+        case MRAA_GPIO_EDGE_RISING:
+            return mraa_gpio_chardev_request(dev, flags, GPIOEVENT_REQUEST_RISING_EDGE, 0);
+        case MRAA_GPIO_EDGE_FALLING:
+            return mraa_gpio_chardev_request(dev, flags, GPIOEVENT_REQUEST_FALLING_EDGE, 0);
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+}
+
+static mraa_result_t
+mraa_gpio_chardev_wait_interrupt_replace(mraa_gpio_context dev, int timeout_ms, int* value)
+{
+    struct gpioevent_data event;
+    struct pollfd pfd;
+    int ret;
+
+    if (dev->line_fd < 0 || dev->line_eventflags == 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    pfd.fd = dev->line_fd;
+    pfd.events = POLLIN;
+
+    // poll is a cancelable point like sleep()
+    ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (ret == 0) {
+        return MRAA_ERROR_NO_DATA_AVAILABLE;
+    }
+    if (read(dev->line_fd, &event, sizeof(event)) != sizeof(event)) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (value != NULL) {
+        *value = event.id == GPIOEVENT_EVENT_RISING_EDGE;
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_adv_func_t*
+mraa_gpio_chardev_func_table(mraa_adv_func_t* base)
+{
+    mraa_adv_func_t* table = NULL;
+    int i;
+
+    pthread_mutex_lock(&func_table_lock);
+    for (i = 0; i < func_table_count; i++) {
+        if (func_tables[i].base == base) {
+            table = &func_tables[i].table;
+            goto table_unlock;
+        }
+    }
+    if (func_table_count == MAX_FUNC_TABLES) {
+        syslog(LOG_ERR, "gpiochip: Too many function tables");
+        goto table_unlock;
+    }
+
+    table = &func_tables[func_table_count].table;
+    func_tables[func_table_count].base = base;
+    func_table_count++;
+
+    if (base != NULL) {
+        memcpy(table, base, sizeof(mraa_adv_func_t));
+    } else {
+        memset(table, 0, sizeof(mraa_adv_func_t));
+    }
+    // pinmux (init_pre/post) and close hooks stay, anything that talks to
+    // sysfs or a register map for the pin itself is replaced
+    table->gpio_init_internal_replace = &mraa_gpio_chardev_init_internal_replace;
+    table->gpio_mode_replace = &mraa_gpio_chardev_mode_replace;
+    table->gpio_mode_pre = NULL;
+    table->gpio_mode_post = NULL;
+    table->gpio_edge_mode_replace = &mraa_gpio_chardev_edge_mode_replace;
+    table->gpio_dir_replace = &mraa_gpio_chardev_dir_replace;
+    table->gpio_dir_pre = NULL;
+    table->gpio_dir_post = NULL;
+    table->gpio_read_replace = &mraa_gpio_chardev_read_replace;
+    table->gpio_write_replace = &mraa_gpio_chardev_write_replace;
+    table->gpio_write_pre = NULL;
+    table->gpio_write_post = NULL;
+    table->gpio_mmap_setup = NULL;
+    table->gpio_interrupt_handler_replace = NULL;
+    table->gpio_isr_poll_setup = NULL;
+    table->gpio_wait_interrupt_replace = &mraa_gpio_chardev_wait_interrupt_replace;
+
+table_unlock:
+    pthread_mutex_unlock(&func_table_lock);
+    return table;
+}
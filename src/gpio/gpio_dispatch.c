@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include "linux/gpio.h"
+
+#define MAX_EVENTS 16
+#define STOP_TOKEN UINT64_MAX
+
+typedef struct {
+    mraa_gpio_context dev; /**< registered context, NULL when the slot is free */
+    int fd; /**< descriptor in the epoll set */
+    mraa_boolean_t chardev; /**< fd is a gpiochip line event */
+    uint32_t generation; /**< bumped on removal so stale events are ignored */
+    mraa_boolean_t busy; /**< isr is running */
+    pthread_t busy_thread; /**< thread running the isr */
+} mraa_gpio_dispatch_entry_t;
+
+static pthread_mutex_t dispatch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dispatch_idle = PTHREAD_COND_INITIALIZER;
+static mraa_gpio_dispatch_entry_t* entries = NULL;
+static int num_entries = 0;
+static int num_registered = 0;
+static int epoll_fd = -1;
+static int stop_fd = -1;
+static unsigned int num_threads = 1;
+static unsigned int running_threads = 0;
+static unsigned int alive_threads = 0;
+static mraa_boolean_t stopping = 0;
+static mraa_boolean_t stop_pending = 0;
+static pthread_t threads[MRAA_GPIO_DISPATCH_MAX_THREADS];
+
+static mraa_boolean_t
+mraa_gpio_dispatch_is_worker()
+{
+    unsigned int i;
+    for (i = 0; i < running_threads; i++) {
+        if (pthread_equal(threads[i], pthread_self())) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static mraa_result_t
+mraa_gpio_dispatch_arm(int slot, int op)
+{
+    struct epoll_event ev;
+
+    // one shot so that a context is only ever handled by one thread at a time
+    ev.events = (entries[slot].chardev ? EPOLLIN : (EPOLLPRI | EPOLLERR)) | EPOLLONESHOT;
+    ev.data.u64 = ((uint64_t) entries[slot].generation << 32) | (uint32_t) slot;
+    if (epoll_ctl(epoll_fd, op, entries[slot].fd, &ev) != 0) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    return MRAA_SUCCESS;
+}
+
+// acknowledge the interrupt and fill in every edge it reported
+static int
+mraa_gpio_dispatch_ack(int fd, mraa_boolean_t chardev, uint64_t now, mraa_gpio_event_t* events)
+{
+    if (chardev) {
+        struct gpioevent_data data[MAX_EVENTS];
+        int i;
+        // a line event fd hands out as many queued events as fit
+        ssize_t len = read(fd, data, sizeof(data));
+        if (len < (ssize_t) sizeof(data[0])) {
+            syslog(LOG_ERR, "gpio dispatch: failed to read line event");
+            return 0;
+        }
+        for (i = 0; i < len / (ssize_t) sizeof(data[0]); i++) {
+            events[i].timestamp = data[i].timestamp;
+            events[i].value = data[i].id == GPIOEVENT_EVENT_RISING_EDGE;
+        }
+        return i;
+    }
+
+    char c = '0';
+    lseek(fd, 0, SEEK_SET);
+    read(fd, &c, 1);
+    events[0].timestamp = now;
+    events[0].value = c == '1';
+    return 1;
+}
+
+void
+mraa_gpio_event_ring_push(mraa_gpio_event_ring_t* ring, const mraa_gpio_event_t* events, int num)
+{
+    unsigned int head = ring->head;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    int i;
+
+    for (i = 0; i < num; i++) {
+        if (head - tail == ring->size) {
+            ring->dropped += num - i;
+            break;
+        }
+        ring->buf[head & (ring->size - 1)] = events[i];
+        head++;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+int
+mraa_gpio_event_ring_pop(mraa_gpio_event_ring_t* ring, mraa_gpio_event_t* events, int max)
+{
+    unsigned int tail = ring->tail;
+    unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    int num = 0;
+
+    while (tail != head && num < max) {
+        events[num++] = ring->buf[tail & (ring->size - 1)];
+        tail++;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return num;
+}
+
+// call with dispatch_lock held
+static void
+mraa_gpio_dispatch_signal_stop()
+{
+    uint64_t one = 1;
+
+    stopping = 1;
+    stop_pending = 0;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        syslog(LOG_ERR, "gpio dispatch: failed to signal threads");
+    }
+}
+
+// the threads are detached, the last one out tears the dispatcher down
+static void*
+mraa_gpio_dispatch_exit()
+{
+    pthread_mutex_lock(&dispatch_lock);
+    if (--alive_threads == 0) {
+        running_threads = 0;
+        close(stop_fd);
+        close(epoll_fd);
+        stop_fd = -1;
+        epoll_fd = -1;
+        stopping = 0;
+        pthread_cond_broadcast(&dispatch_idle);
+    }
+    pthread_mutex_unlock(&dispatch_lock);
+    return NULL;
+}
+
+static void*
+mraa_gpio_dispatch_thread(void* arg)
+{
+    struct epoll_event events[MAX_EVENTS];
+    mraa_gpio_dispatch_entry_t ready[MAX_EVENTS];
+    int slots[MAX_EVENTS];
+    int priority[MAX_EVENTS];
+    mraa_gpio_event_t edges[MAX_EVENTS];
+    struct timespec now;
+
+    for (;;) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            syslog(LOG_ERR, "gpio dispatch: epoll_wait failed");
+            return mraa_gpio_dispatch_exit();
+        }
+        // sysfs does not timestamp edges, the wake up is the closest we get
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        mraa_boolean_t stop = 0;
+        int num_ready = 0;
+        int i, j;
+
+        pthread_mutex_lock(&dispatch_lock);
+        for (i = 0; i < n; i++) {
+            if (events[i].data.u64 == STOP_TOKEN) {
+                stop = 1;
+                continue;
+            }
+            int slot = (int) (uint32_t) events[i].data.u64;
+            uint32_t generation = (uint32_t) (events[i].data.u64 >> 32);
+            if (slot >= num_entries || entries[slot].dev == NULL || entries[slot].generation != generation) {
+                continue;
+            }
+            entries[slot].busy = 1;
+            entries[slot].busy_thread = pthread_self();
+
+            // highest priority first, equal priorities keep epoll order
+            int prio = entries[slot].dev->isr_priority;
+            for (j = num_ready; j > 0 && priority[j - 1] < prio; j--) {
+                ready[j] = ready[j - 1];
+                slots[j] = slots[j - 1];
+                priority[j] = priority[j - 1];
+            }
+            // entries can be reallocated by mraa_gpio_dispatch_add() so work on a copy
+            ready[j] = entries[slot];
+            slots[j] = slot;
+            priority[j] = prio;
+            num_ready++;
+        }
+        pthread_mutex_unlock(&dispatch_lock);
+
+        for (i = 0; i < num_ready; i++) {
+            int slot = slots[i];
+            int num = mraa_gpio_dispatch_ack(ready[i].fd, ready[i].chardev,
+                                             (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec, edges);
+            if (ready[i].dev->capture != NULL) {
+                mraa_gpio_capture_push(ready[i].dev->capture, edges, num);
+            } else if (ready[i].dev->events != NULL) {
+                mraa_gpio_event_ring_push(ready[i].dev->events, edges, num);
+            } else {
+                for (j = 0; j < num; j++) {
+                    mraa_gpio_isr_call(ready[i].dev);
+                }
+            }
+
+            pthread_mutex_lock(&dispatch_lock);
+            entries[slot].busy = 0;
+            if (entries[slot].dev != NULL) {
+                mraa_gpio_dispatch_arm(slot, EPOLL_CTL_MOD);
+            }
+            pthread_cond_broadcast(&dispatch_idle);
+            pthread_mutex_unlock(&dispatch_lock);
+        }
+
+        // the last isr removed itself from its callback, stop now the batch is done
+        pthread_mutex_lock(&dispatch_lock);
+        if (stop_pending && num_registered == 0 && !stopping) {
+            mraa_gpio_dispatch_signal_stop();
+        }
+        pthread_mutex_unlock(&dispatch_lock);
+
+        if (stop) {
+            return mraa_gpio_dispatch_exit();
+        }
+    }
+}
+
+static mraa_result_t
+mraa_gpio_dispatch_start()
+{
+    struct epoll_event ev;
+    unsigned int i;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        syslog(LOG_ERR, "gpio dispatch: failed to create epoll instance");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_fd == -1) {
+        syslog(LOG_ERR, "gpio dispatch: failed to create eventfd");
+        close(epoll_fd);
+        epoll_fd = -1;
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    // level triggered and never read, so once written every thread sees it
+    ev.events = EPOLLIN;
+    ev.data.u64 = STOP_TOKEN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+
+    for (i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[running_threads], NULL, mraa_gpio_dispatch_thread, NULL) != 0) {
+            syslog(LOG_ERR, "gpio dispatch: failed to create thread");
+            break;
+        }
+        pthread_detach(threads[running_threads]);
+        running_threads++;
+    }
+    alive_threads = running_threads;
+    if (running_threads == 0) {
+        close(stop_fd);
+        close(epoll_fd);
+        stop_fd = -1;
+        epoll_fd = -1;
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    return MRAA_SUCCESS;
+}
+
+// called and returns with dispatch_lock held, drops it whilst the threads exit
+static void
+mraa_gpio_dispatch_stop()
+{
+    mraa_gpio_dispatch_signal_stop();
+    while (stopping) {
+        pthread_cond_wait(&dispatch_idle, &dispatch_lock);
+    }
+}
+
+mraa_result_t
+mraa_gpio_dispatch_add(mraa_gpio_context dev, int fd, mraa_boolean_t chardev)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+    int slot;
+
+    pthread_mutex_lock(&dispatch_lock);
+    while (stopping) {
+        pthread_cond_wait(&dispatch_idle, &dispatch_lock);
+    }
+    if (running_threads == 0) {
+        ret = mraa_gpio_dispatch_start();
+        if (ret != MRAA_SUCCESS) {
+            goto add_unlock;
+        }
+    }
+
+    for (slot = 0; slot < num_entries; slot++) {
+        if (entries[slot].dev == NULL && !entries[slot].busy) {
+            break;
+        }
+    }
+    if (slot == num_entries) {
+        mraa_gpio_dispatch_entry_t* grown =
+        (mraa_gpio_dispatch_entry_t*) realloc(entries, (num_entries + 8) * sizeof(mraa_gpio_dispatch_entry_t));
+        if (grown == NULL) {
+            ret = MRAA_ERROR_NO_RESOURCES;
+            goto add_unlock;
+        }
+        memset(grown + num_entries, 0, 8 * sizeof(mraa_gpio_dispatch_entry_t));
+        entries = grown;
+        num_entries += 8;
+    }
+
+    entries[slot].dev = dev;
+    entries[slot].fd = fd;
+    entries[slot].chardev = chardev;
+    ret = mraa_gpio_dispatch_arm(slot, EPOLL_CTL_ADD);
+    if (ret != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "gpio dispatch: failed to watch gpio%d", dev->pin);
+        entries[slot].dev = NULL;
+        entries[slot].generation++;
+        goto add_unlock;
+    }
+    num_registered++;
+    // an isr that removed the last registration and added another keeps the threads
+    stop_pending = 0;
+
+add_unlock:
+    pthread_mutex_unlock(&dispatch_lock);
+    return ret;
+}
+
+mraa_result_t
+mraa_gpio_dispatch_remove(mraa_gpio_context dev)
+{
+    int slot;
+
+    pthread_mutex_lock(&dispatch_lock);
+    for (slot = 0; slot < num_entries; slot++) {
+        if (entries[slot].dev == dev) {
+            break;
+        }
+    }
+    if (slot == num_entries) {
+        pthread_mutex_unlock(&dispatch_lock);
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, entries[slot].fd, NULL);
+    entries[slot].dev = NULL;
+    entries[slot].generation++;
+    num_registered--;
+
+    // an isr removing itself cannot wait for itself to finish
+    while (entries[slot].busy && !pthread_equal(entries[slot].busy_thread, pthread_self())) {
+        pthread_cond_wait(&dispatch_idle, &dispatch_lock);
+    }
+
+    if (num_registered == 0 && !stopping) {
+        // a worker can't wait for itself to exit, it stops once its batch is done
+        if (mraa_gpio_dispatch_is_worker()) {
+            stop_pending = 1;
+        } else {
+            mraa_gpio_dispatch_stop();
+        }
+    }
+    pthread_mutex_unlock(&dispatch_lock);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_dispatch_threads(unsigned int num)
+{
+    if (num == 0 || num > MRAA_GPIO_DISPATCH_MAX_THREADS) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    pthread_mutex_lock(&dispatch_lock);
+    num_threads = num;
+    pthread_mutex_unlock(&dispatch_lock);
+    return MRAA_SUCCESS;
+}
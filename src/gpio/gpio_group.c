@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_chardev.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "linux/gpio.h"
+
+#define MAX_BANKS 8
+
+static void
+mraa_gpio_group_free(mraa_gpio_group_context dev)
+{
+    unsigned int bank;
+    int i;
+
+    for (bank = 0; bank < MAX_BANKS; bank++) {
+        if (dev->mmap_banks & (1u << bank)) {
+            dev->advance_func->gpio_mmap_bank_setup(bank, 0);
+        }
+    }
+
+    for (i = 0; i < dev->num_chips; i++) {
+        if (dev->chips[i].line_fd != -1) {
+            close(dev->chips[i].line_fd);
+        }
+    }
+    for (i = 0; i < dev->num_pins; i++) {
+        if (dev->gpio[i] != NULL) {
+            mraa_gpio_close(dev->gpio[i]);
+        }
+    }
+    free(dev->chips);
+    free(dev->pin_chip);
+    free(dev->pin_line);
+    free(dev->gpio);
+    free(dev);
+}
+
+static mraa_result_t
+mraa_gpio_group_setup_chips(mraa_gpio_group_context dev)
+{
+    struct stat chip_stat[MRAA_GPIO_GROUP_MAX_PINS];
+    int i, c;
+
+    dev->chips = (mraa_gpio_group_chip_t*) calloc(dev->num_pins, sizeof(mraa_gpio_group_chip_t));
+    dev->pin_chip = (int*) calloc(dev->num_pins, sizeof(int));
+    dev->pin_line = (int*) calloc(dev->num_pins, sizeof(int));
+    if (dev->chips == NULL || dev->pin_chip == NULL || dev->pin_line == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    for (i = 0; i < dev->num_pins; i++) {
+        mraa_gpio_context gpio = dev->gpio[i];
+
+        // the group owns the lines from now on, the pin contexts only keep
+        // their chip open for muxing and close
+        if (gpio->line_fd != -1) {
+            close(gpio->line_fd);
+            gpio->line_fd = -1;
+        }
+        if (fstat(gpio->chip_fd, &chip_stat[i]) != 0) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+
+        for (c = 0; c < dev->num_chips; c++) {
+            if (chip_stat[c].st_rdev == chip_stat[i].st_rdev) {
+                break;
+            }
+        }
+        if (c == dev->num_chips) {
+            chip_stat[c] = chip_stat[i];
+            dev->chips[c].chip_fd = gpio->chip_fd;
+            dev->chips[c].line_fd = -1;
+            dev->num_chips++;
+        }
+        dev->pin_chip[i] = c;
+        dev->pin_line[i] = dev->chips[c].num_lines;
+        dev->chips[c].offsets[dev->chips[c].num_lines++] = gpio->line_offset;
+    }
+
+    for (c = 0; c < dev->num_chips; c++) {
+        dev->chips[c].line_fd = mraa_gpiochip_request_lines(dev->chips[c].chip_fd, dev->chips[c].offsets,
+                                                            dev->chips[c].num_lines, 0, NULL);
+        if (dev->chips[c].line_fd == -1) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+static mraa_gpio_group_context
+mraa_gpio_group_init_internal(const int* pins, int num_pins, mraa_boolean_t chardev)
+{
+    int i;
+
+    if (pins == NULL || num_pins <= 0 || num_pins > MRAA_GPIO_GROUP_MAX_PINS) {
+        syslog(LOG_ERR, "gpio group: invalid pin list");
+        return NULL;
+    }
+
+    mraa_gpio_group_context dev = (mraa_gpio_group_context) calloc(1, sizeof(struct _gpio_group));
+    if (dev == NULL) {
+        syslog(LOG_CRIT, "gpio group: Failed to allocate memory for context");
+        return NULL;
+    }
+    dev->gpio = (mraa_gpio_context*) calloc(num_pins, sizeof(mraa_gpio_context));
+    if (dev->gpio == NULL) {
+        syslog(LOG_CRIT, "gpio group: Failed to allocate memory for context");
+        free(dev);
+        return NULL;
+    }
+    dev->num_pins = num_pins;
+
+    for (i = 0; i < num_pins; i++) {
+        dev->gpio[i] = chardev ? mraa_gpio_init_chardev(pins[i]) : mraa_gpio_init(pins[i]);
+        if (dev->gpio[i] == NULL) {
+            syslog(LOG_ERR, "gpio group: failed to initialise pin %d", pins[i]);
+            mraa_gpio_group_free(dev);
+            return NULL;
+        }
+    }
+    dev->advance_func = dev->gpio[0]->advance_func;
+
+    if (chardev) {
+        if (mraa_gpio_group_setup_chips(dev) != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "gpio group: failed to request gpiochip lines");
+            mraa_gpio_group_free(dev);
+            return NULL;
+        }
+        return dev;
+    }
+
+    // bank registers are only safe to touch whilst they are mapped, either
+    // by the group itself or because every pin holds the mmap
+    dev->mmap = IS_FUNC_DEFINED(dev, gpio_mmap_bank_write) && IS_FUNC_DEFINED(dev, gpio_mmap_bank_read);
+    for (i = 0; i < num_pins && dev->mmap; i++) {
+        if (dev->gpio[i]->pin / 32 >= MAX_BANKS) {
+            dev->mmap = 0;
+        }
+    }
+    if (dev->mmap && IS_FUNC_DEFINED(dev, gpio_mmap_bank_setup)) {
+        for (i = 0; i < num_pins; i++) {
+            unsigned int bank = dev->gpio[i]->pin / 32;
+            if (dev->mmap_banks & (1u << bank)) {
+                continue;
+            }
+            if (dev->advance_func->gpio_mmap_bank_setup(bank, 1) != MRAA_SUCCESS) {
+                syslog(LOG_NOTICE, "gpio group: bank %u registers unavailable, using sysfs", bank);
+                dev->mmap = 0;
+                break;
+            }
+            dev->mmap_banks |= 1u << bank;
+        }
+    } else {
+        for (i = 0; i < num_pins && dev->mmap; i++) {
+            if (dev->gpio[i]->mmap_write == NULL) {
+                dev->mmap = 0;
+            }
+        }
+    }
+    return dev;
+}
+
+mraa_gpio_group_context
+mraa_gpio_group_init(const int* pins, int num_pins)
+{
+    return mraa_gpio_group_init_internal(pins, num_pins, 0);
+}
+
+mraa_gpio_group_context
+mraa_gpio_group_init_chardev(const int* pins, int num_pins)
+{
+    return mraa_gpio_group_init_internal(pins, num_pins, 1);
+}
+
+mraa_result_t
+mraa_gpio_group_dir(mraa_gpio_group_context dev, mraa_gpio_dir_t dir)
+{
+    uint8_t values[MRAA_GPIOCHIP_LINES_MAX];
+    unsigned int flags;
+    int i, c;
+
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (dev->num_chips == 0) {
+        for (i = 0; i < dev->num_pins; i++) {
+            mraa_result_t ret = mraa_gpio_dir(dev->gpio[i], dir);
+            if (ret != MRAA_SUCCESS) {
+                return ret;
+            }
+        }
+        return MRAA_SUCCESS;
+    }
+
+    switch (dir) {
+        case MRAA_GPIO_IN:
+            flags = GPIOHANDLE_REQUEST_INPUT;
+            break;
+        case MRAA_GPIO_OUT:
+        case MRAA_GPIO_OUT_LOW:
+        case MRAA_GPIO_OUT_HIGH:
+            flags = GPIOHANDLE_REQUEST_OUTPUT;
+            break;
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+    memset(values, dir == MRAA_GPIO_OUT_HIGH ? 1 : 0, sizeof(values));
+
+    for (c = 0; c < dev->num_chips; c++) {
+        close(dev->chips[c].line_fd);
+        dev->chips[c].line_fd = mraa_gpiochip_request_lines(dev->chips[c].chip_fd, dev->chips[c].offsets,
+                                                            dev->chips[c].num_lines, flags, values);
+        if (dev->chips[c].line_fd == -1) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_group_read(mraa_gpio_group_context dev, uint32_t* value)
+{
+    int i;
+
+    if (dev == NULL || value == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    *value = 0;
+
+    if (dev->mmap) {
+        uint32_t banks[MAX_BANKS];
+        uint32_t read_banks = 0;
+        for (i = 0; i < dev->num_pins; i++) {
+            int pin = dev->gpio[i]->pin;
+            if (!(read_banks & (1 << (pin / 32)))) {
+                mraa_result_t ret = dev->advance_func->gpio_mmap_bank_read(pin / 32, &banks[pin / 32]);
+                if (ret != MRAA_SUCCESS) {
+                    return ret;
+                }
+                read_banks |= 1 << (pin / 32);
+            }
+            if (banks[pin / 32] & ((uint32_t) 1 << (pin % 32))) {
+                *value |= (uint32_t) 1 << i;
+            }
+        }
+        return MRAA_SUCCESS;
+    }
+
+    if (dev->num_chips > 0) {
+        uint8_t values[MRAA_GPIO_GROUP_MAX_PINS][MRAA_GPIOCHIP_LINES_MAX];
+        int c;
+        for (c = 0; c < dev->num_chips; c++) {
+            mraa_result_t ret = mraa_gpiochip_get_values(dev->chips[c].line_fd, values[c], dev->chips[c].num_lines);
+            if (ret != MRAA_SUCCESS) {
+                return ret;
+            }
+        }
+        for (i = 0; i < dev->num_pins; i++) {
+            if (values[dev->pin_chip[i]][dev->pin_line[i]]) {
+                *value |= (uint32_t) 1 << i;
+            }
+        }
+        return MRAA_SUCCESS;
+    }
+
+    for (i = 0; i < dev->num_pins; i++) {
+        int level = mraa_gpio_read(dev->gpio[i]);
+        if (level < 0) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        if (level) {
+            *value |= (uint32_t) 1 << i;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_group_write(mraa_gpio_group_context dev, uint32_t value)
+{
+    int i;
+
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (dev->mmap) {
+        uint32_t mask[MAX_BANKS] = { 0 };
+        uint32_t bits[MAX_BANKS] = { 0 };
+        unsigned int bank;
+        for (i = 0; i < dev->num_pins; i++) {
+            int pin = dev->gpio[i]->pin;
+            mask[pin / 32] |= (uint32_t) 1 << (pin % 32);
+            if (value & ((uint32_t) 1 << i)) {
+                bits[pin / 32] |= (uint32_t) 1 << (pin % 32);
+            }
+        }
+        for (bank = 0; bank < MAX_BANKS; bank++) {
+            if (mask[bank] != 0) {
+                mraa_result_t ret = dev->advance_func->gpio_mmap_bank_write(bank, mask[bank], bits[bank]);
+                if (ret != MRAA_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+        return MRAA_SUCCESS;
+    }
+
+    if (dev->num_chips > 0) {
+        uint8_t values[MRAA_GPIO_GROUP_MAX_PINS][MRAA_GPIOCHIP_LINES_MAX];
+        int c;
+        for (i = 0; i < dev->num_pins; i++) {
+            values[dev->pin_chip[i]][dev->pin_line[i]] = (value >> i) & 1;
+        }
+        for (c = 0; c < dev->num_chips; c++) {
+            mraa_result_t ret = mraa_gpiochip_set_values(dev->chips[c].line_fd, values[c], dev->chips[c].num_lines);
+            if (ret != MRAA_SUCCESS) {
+                return ret;
+            }
+        }
+        return MRAA_SUCCESS;
+    }
+
+    for (i = 0; i < dev->num_pins; i++) {
+        mraa_result_t ret = mraa_gpio_write(dev->gpio[i], (value >> i) & 1);
+        if (ret != MRAA_SUCCESS) {
+            return ret;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_group_close(mraa_gpio_group_context dev)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    mraa_gpio_group_free(dev);
+    return MRAA_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct _gpio_vcd {
+    FILE* file;
+    unsigned int bank;
+    uint32_t mask;
+    uint32_t last; /**< last value written */
+    mraa_boolean_t started; /**< initial values have been dumped */
+    unsigned long long origin; /**< timestamp of time 0 */
+    unsigned long long last_time; /**< last time written, relative to origin */
+    unsigned long long end_time; /**< end of the last samples written, relative to origin */
+};
+
+static unsigned long long
+mraa_gpio_sample_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+mraa_result_t
+mraa_gpio_sample_bank(mraa_gpio_context dev, uint32_t* samples, unsigned int num_samples, unsigned int chunk_size, unsigned long long* timestamps)
+{
+    mraa_result_t (*bank_read)(unsigned int bank, uint32_t* value);
+    mraa_result_t ret = MRAA_SUCCESS;
+    unsigned int bank, chunk, i;
+
+    if (dev == NULL || samples == NULL || timestamps == NULL || chunk_size == 0) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (dev->pin < 0 || !IS_FUNC_DEFINED(dev, gpio_mmap_bank_read) || !IS_FUNC_DEFINED(dev, gpio_mmap_bank_setup)) {
+        syslog(LOG_ERR, "gpio sample: gpio%d cannot read its bank through mmap", dev->pin);
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    bank_read = dev->advance_func->gpio_mmap_bank_read;
+    bank = dev->pin / 32;
+
+    // hold the bank mapped for the capture whether or not the pin uses mmap
+    if (dev->advance_func->gpio_mmap_bank_setup(bank, 1) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "gpio sample: failed to map the bank of gpio%d", dev->pin);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    for (chunk = 0, i = 0; i < num_samples && ret == MRAA_SUCCESS; chunk++) {
+        unsigned int end = i + chunk_size < num_samples ? i + chunk_size : num_samples;
+        timestamps[chunk] = mraa_gpio_sample_now();
+        for (; i < end; i++) {
+            if (bank_read(bank, &samples[i]) != MRAA_SUCCESS) {
+                ret = MRAA_ERROR_INVALID_RESOURCE;
+                break;
+            }
+        }
+    }
+    timestamps[chunk] = mraa_gpio_sample_now();
+    dev->advance_func->gpio_mmap_bank_setup(bank, 0);
+    return ret;
+}
+
+static void
+mraa_gpio_vcd_changes(mraa_gpio_vcd_context vcd, uint32_t value, uint32_t changed)
+{
+    int bit;
+    for (bit = 0; bit < 32; bit++) {
+        if (changed & ((uint32_t) 1 << bit)) {
+            fprintf(vcd->file, "%c%c\n", (value & ((uint32_t) 1 << bit)) ? '1' : '0', '!' + bit);
+        }
+    }
+}
+
+mraa_gpio_vcd_context
+mraa_gpio_vcd_open(const char* path, unsigned int bank, uint32_t mask)
+{
+    int bit;
+
+    if (path == NULL || mask == 0) {
+        return NULL;
+    }
+    mraa_gpio_vcd_context vcd = (mraa_gpio_vcd_context) calloc(1, sizeof(struct _gpio_vcd));
+    if (vcd == NULL) {
+        return NULL;
+    }
+    vcd->file = fopen(path, "w");
+    if (vcd->file == NULL) {
+        syslog(LOG_ERR, "gpio vcd: failed to create %s", path);
+        free(vcd);
+        return NULL;
+    }
+    vcd->bank = bank;
+    vcd->mask = mask;
+
+    fprintf(vcd->file, "$version libmraa %s $end\n", mraa_get_version());
+    fprintf(vcd->file, "$timescale 1ns $end\n");
+    fprintf(vcd->file, "$scope module gpio_bank%u $end\n", bank);
+    for (bit = 0; bit < 32; bit++) {
+        if (mask & ((uint32_t) 1 << bit)) {
+            // identifiers are single printable characters, one per bank bit
+            fprintf(vcd->file, "$var wire 1 %c gpio%u $end\n", '!' + bit, bank * 32 + bit);
+        }
+    }
+    fprintf(vcd->file, "$upscope $end\n$enddefinitions $end\n");
+    return vcd;
+}
+
+mraa_result_t
+mraa_gpio_vcd_write(mraa_gpio_vcd_context vcd, const uint32_t* samples, unsigned int num_samples, unsigned int chunk_size, const unsigned long long* timestamps)
+{
+    unsigned int i;
+
+    if (vcd == NULL || samples == NULL || timestamps == NULL || chunk_size == 0) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (num_samples == 0) {
+        return MRAA_SUCCESS;
+    }
+
+    if (!vcd->started) {
+        vcd->origin = timestamps[0];
+        vcd->last = samples[0] & vcd->mask;
+        fprintf(vcd->file, "#0\n$dumpvars\n");
+        mraa_gpio_vcd_changes(vcd, vcd->last, vcd->mask);
+        fprintf(vcd->file, "$end\n");
+        vcd->started = 1;
+    }
+
+    for (i = 0; i < num_samples; i++) {
+        uint32_t value = samples[i] & vcd->mask;
+        // unchanged samples are the common case and produce no output
+        if (value == vcd->last) {
+            continue;
+        }
+
+        unsigned int chunk = i / chunk_size;
+        unsigned int len = num_samples - chunk * chunk_size < chunk_size ? num_samples - chunk * chunk_size : chunk_size;
+        unsigned long long start = timestamps[chunk];
+        unsigned long long time = start + (timestamps[chunk + 1] - start) * (i % chunk_size) / len;
+        time = time > vcd->origin ? time - vcd->origin : 0;
+        if (time < vcd->last_time) {
+            time = vcd->last_time;
+        }
+        if (time != vcd->last_time) {
+            fprintf(vcd->file, "#%llu\n", time);
+        }
+        mraa_gpio_vcd_changes(vcd, value, value ^ vcd->last);
+        vcd->last = value;
+        vcd->last_time = time;
+    }
+    unsigned long long end = timestamps[(num_samples + chunk_size - 1) / chunk_size];
+    vcd->end_time = end > vcd->origin ? end - vcd->origin : 0;
+
+    if (ferror(vcd->file)) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_vcd_close(mraa_gpio_vcd_context vcd)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    if (vcd == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    // mark how long the capture ran after the last change
+    if (vcd->started && vcd->end_time > vcd->last_time) {
+        fprintf(vcd->file, "#%llu\n", vcd->end_time);
+    }
+    if (fclose(vcd->file) != 0) {
+        ret = MRAA_ERROR_INVALID_RESOURCE;
+    }
+    free(vcd);
+    return ret;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define MAX_BANKS 8
+#define CALIBRATION_LOOPS 1000000
+#define CALIBRATION_WRITES 64
+
+static pthread_once_t calibrate_once = PTHREAD_ONCE_INIT;
+// busy wait iterations per nanosecond, 16.16 fixed point
+static uint64_t loops_per_ns = 0;
+
+static inline void
+mraa_gpio_wave_spin(uint64_t loops)
+{
+    while (loops--) {
+        __asm__ __volatile__("" ::: "memory");
+    }
+}
+
+static uint64_t
+mraa_gpio_wave_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void
+mraa_gpio_wave_calibrate()
+{
+    uint64_t best = UINT64_MAX;
+    int i;
+
+    // take the fastest of a few runs, the slower ones were preempted
+    for (i = 0; i < 5; i++) {
+        uint64_t start = mraa_gpio_wave_now();
+        mraa_gpio_wave_spin(CALIBRATION_LOOPS);
+        uint64_t elapsed = mraa_gpio_wave_now() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    if (best == 0) {
+        best = 1;
+    }
+    loops_per_ns = ((uint64_t) CALIBRATION_LOOPS << 16) / best;
+    syslog(LOG_DEBUG, "gpio wave: %llu busy wait loops per us", (unsigned long long) (loops_per_ns * 1000) >> 16);
+}
+
+mraa_result_t
+mraa_gpio_group_wave_step(mraa_gpio_group_context dev, uint32_t mask, uint32_t value, uint32_t delay_ns, mraa_gpio_wave_step_t* step)
+{
+    int bank = -1;
+    int i;
+
+    if (dev == NULL || step == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    step->mask = 0;
+    step->value = 0;
+    step->delay_ns = delay_ns;
+    for (i = 0; i < dev->num_pins; i++) {
+        if (!(mask & ((uint32_t) 1 << i))) {
+            continue;
+        }
+        int pin = dev->gpio[i]->pin;
+        if (bank != -1 && bank != pin / 32) {
+            syslog(LOG_ERR, "gpio wave: step spans more than one bank");
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+        bank = pin / 32;
+        step->mask |= (uint32_t) 1 << (pin % 32);
+        if (value & ((uint32_t) 1 << i)) {
+            step->value |= (uint32_t) 1 << (pin % 32);
+        }
+    }
+    step->bank = bank == -1 ? 0 : bank;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_group_wave(mraa_gpio_group_context dev, const mraa_gpio_wave_step_t* steps, unsigned int num_steps, mraa_boolean_t realtime)
+{
+    uint32_t allowed[MAX_BANKS] = { 0 };
+    mraa_result_t (*bank_write)(unsigned int bank, uint32_t mask, uint32_t value);
+    struct sched_param param, old_param;
+    int old_policy = SCHED_OTHER;
+    mraa_boolean_t boosted = 0;
+    uint64_t write_ns;
+    unsigned int i;
+
+    if (dev == NULL || (steps == NULL && num_steps > 0)) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (!dev->mmap) {
+        syslog(LOG_ERR, "gpio wave: group cannot use mmap bank registers");
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    bank_write = dev->advance_func->gpio_mmap_bank_write;
+
+    // never let a waveform touch pins outside the group
+    for (i = 0; i < (unsigned int) dev->num_pins; i++) {
+        allowed[dev->gpio[i]->pin / 32] |= (uint32_t) 1 << (dev->gpio[i]->pin % 32);
+    }
+    for (i = 0; i < num_steps; i++) {
+        if (steps[i].bank >= MAX_BANKS || (steps[i].mask & ~allowed[steps[i].bank]) != 0) {
+            syslog(LOG_ERR, "gpio wave: step %u changes pins outside the group", i);
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    if (num_steps == 0) {
+        return MRAA_SUCCESS;
+    }
+    pthread_once(&calibrate_once, mraa_gpio_wave_calibrate);
+
+    // the register write itself takes time, take it off every delay
+    uint64_t start = mraa_gpio_wave_now();
+    for (i = 0; i < CALIBRATION_WRITES; i++) {
+        bank_write(steps[0].bank, 0, 0);
+    }
+    write_ns = (mraa_gpio_wave_now() - start) / CALIBRATION_WRITES;
+
+    if (realtime) {
+        pthread_getschedparam(pthread_self(), &old_policy, &old_param);
+        param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+            boosted = 1;
+        } else {
+            syslog(LOG_WARNING, "gpio wave: could not switch to SCHED_FIFO");
+        }
+    }
+
+    for (i = 0; i < num_steps; i++) {
+        bank_write(steps[i].bank, steps[i].mask, steps[i].value);
+        if (steps[i].delay_ns > write_ns) {
+            mraa_gpio_wave_spin(((steps[i].delay_ns - write_ns) * loops_per_ns) >> 16);
+        }
+    }
+
+    if (boosted) {
+        pthread_setschedparam(pthread_self(), old_policy, &old_param);
+    }
+    return MRAA_SUCCESS;
+}
@@ -27,16 +27,28 @@
 
 #include "i2c.h"
 #include "mraa_internal.h"
+#include "i2c/i2c_queue.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 #include <inttypes.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include "linux/i2c-dev.h"
 
+// i2c-dev refuses messages longer than this
+#define I2C_DEV_MSG_MAX 8192
+// i2cdetect probes these, the rest are reserved
+#define SCAN_FIRST 0x03
+#define SCAN_LAST 0x77
+// a 24Cxx write cycle takes at most 5ms, poll for the ack a bit beyond that
+#define EEPROM_ACK_POLLS 40
+#define EEPROM_ACK_POLL_US 250
+
 
 typedef union i2c_smbus_data_union {
     uint8_t byte;        ///< data byte
@@ -52,6 +64,34 @@ typedef struct i2c_smbus_ioctl_data_struct {
     i2c_smbus_data_t* data; ///< data
 } i2c_smbus_ioctl_data_t;
 
+typedef struct _i2c_shared_bus {
+    unsigned int busnum; /**< number of the /dev/i2c-* device */
+    int fh; /**< descriptor shared by every context on the bus */
+    unsigned long funcs; /**< adapter capabilities, queried once */
+    int addr; /**< slave address last set with I2C_SLAVE_FORCE, -1 if none */
+    int refs; /**< contexts using the bus */
+    pthread_mutex_t lock; /**< held around every access to fh */
+    struct _i2c_shared_bus* next; /**< list of open buses */
+} mraa_i2c_shared_bus_t;
+
+static pthread_mutex_t buses_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_i2c_shared_bus_t* buses = NULL;
+
+typedef struct _i2c_scan {
+    int bus; /**< bus number as given to mraa_i2c_init() */
+    uint8_t bitmap[MRAA_I2C_SCAN_BYTES]; /**< answering addresses */
+    struct _i2c_scan* next; /**< list of cached scans */
+} mraa_i2c_scan_t;
+
+typedef struct {
+    int bus; /**< bus to scan */
+    uint8_t* bitmap; /**< where to put the result */
+    mraa_result_t result; /**< outcome of the scan */
+} mraa_i2c_scan_job_t;
+
+static pthread_mutex_t scans_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_i2c_scan_t* scans = NULL;
+
 
 // static mraa_adv_func_t* func_table;
 
@@ -68,6 +108,120 @@ mraa_i2c_smbus_access(int fh, uint8_t read_write, uint8_t command, int size, i2c
     return ioctl(fh, I2C_SMBUS, &args);
 }
 
+/**
+ * Take a reference on the shared state of /dev/i2c-<bus>, opening it when no
+ * other context uses the bus
+ */
+static mraa_i2c_shared_bus_t*
+mraa_i2c_bus_get(unsigned int busnum)
+{
+    mraa_i2c_shared_bus_t* bus;
+    char filepath[128];
+
+    pthread_mutex_lock(&buses_lock);
+    for (bus = buses; bus != NULL; bus = bus->next) {
+        if (bus->busnum == busnum) {
+            bus->refs++;
+            pthread_mutex_unlock(&buses_lock);
+            return bus;
+        }
+    }
+
+    bus = (mraa_i2c_shared_bus_t*) calloc(1, sizeof(mraa_i2c_shared_bus_t));
+    if (bus == NULL) {
+        syslog(LOG_CRIT, "i2c: Failed to allocate memory for bus");
+        pthread_mutex_unlock(&buses_lock);
+        return NULL;
+    }
+    mraa_sysfs_path(filepath, sizeof(filepath), "/dev/i2c-%u", busnum);
+    if ((bus->fh = open(filepath, O_RDWR)) < 1) {
+        syslog(LOG_ERR, "i2c: Failed to open requested i2c port %s", filepath);
+        free(bus);
+        pthread_mutex_unlock(&buses_lock);
+        return NULL;
+    }
+    if (ioctl(bus->fh, I2C_FUNCS, &bus->funcs) < 0) {
+        syslog(LOG_CRIT, "i2c: Failed to get I2C_FUNC map from device");
+        bus->funcs = 0;
+    }
+    bus->busnum = busnum;
+    bus->addr = -1;
+    bus->refs = 1;
+    pthread_mutex_init(&bus->lock, NULL);
+    bus->next = buses;
+    buses = bus;
+    pthread_mutex_unlock(&buses_lock);
+    return bus;
+}
+
+static void
+mraa_i2c_bus_put(mraa_i2c_shared_bus_t* bus)
+{
+    mraa_i2c_shared_bus_t** pos;
+
+    pthread_mutex_lock(&buses_lock);
+    if (--bus->refs > 0) {
+        pthread_mutex_unlock(&buses_lock);
+        return;
+    }
+    for (pos = &buses; *pos != bus; pos = &(*pos)->next)
+        ;
+    *pos = bus->next;
+    pthread_mutex_unlock(&buses_lock);
+
+    close(bus->fh);
+    pthread_mutex_destroy(&bus->lock);
+    free(bus);
+}
+
+/**
+ * Lock the shared bus for one access. When slave is set the kernel's slave
+ * address is switched to the one of dev first, unless the previous access
+ * already left it there.
+ */
+static mraa_result_t
+mraa_i2c_bus_lock(mraa_i2c_context dev, mraa_boolean_t slave)
+{
+    mraa_i2c_shared_bus_t* bus = dev->bus;
+
+    if (bus == NULL) {
+        return MRAA_SUCCESS;
+    }
+    pthread_mutex_lock(&bus->lock);
+    if (slave && dev->addr >= 0 && bus->addr != dev->addr) {
+        if (ioctl(bus->fh, I2C_SLAVE_FORCE, dev->addr) < 0) {
+            bus->addr = -1;
+            pthread_mutex_unlock(&bus->lock);
+            syslog(LOG_ERR, "i2c: Failed to set slave address %d", dev->addr);
+            return MRAA_ERROR_INVALID_HANDLE;
+        }
+        bus->addr = dev->addr;
+    }
+    return MRAA_SUCCESS;
+}
+
+static void
+mraa_i2c_bus_unlock(mraa_i2c_context dev)
+{
+    if (dev->bus != NULL) {
+        pthread_mutex_unlock(&dev->bus->lock);
+    }
+}
+
+/**
+ * mraa_i2c_smbus_access() on the shared bus, addressed to the slave of dev
+ */
+static int
+mraa_i2c_smbus(mraa_i2c_context dev, uint8_t read_write, uint8_t command, int size, i2c_smbus_data_t* data)
+{
+    if (mraa_i2c_bus_lock(dev, 1) != MRAA_SUCCESS) {
+        return -1;
+    }
+    int ret = mraa_i2c_smbus_access(dev->fh, read_write, command, size, data);
+    mraa_i2c_bus_unlock(dev);
+    return ret;
+}
+
 static mraa_i2c_context
 mraa_i2c_init_internal(mraa_adv_func_t* advance_func, unsigned int bus)
 {
@@ -84,6 +238,12 @@ mraa_i2c_init_internal(mraa_adv_func_t* advance_func, unsigned int bus)
 
     dev->advance_func = advance_func;
     dev->busnum = bus;
+    dev->max_transfer = 0;
+    dev->auto_increment = 0;
+    dev->addr = -1;
+    dev->bus = NULL;
+    dev->queue = NULL;
+    dev->pending = 0;
 
     if (IS_FUNC_DEFINED(dev, i2c_init_pre)) {
         status = advance_func->i2c_init_pre(bus);
@@ -96,18 +256,13 @@ mraa_i2c_init_internal(mraa_adv_func_t* advance_func, unsigned int bus)
         if (status != MRAA_SUCCESS)
             goto init_internal_cleanup;
     } else {
-        char filepath[32];
-        snprintf(filepath, 32, "/dev/i2c-%u", bus);
-        if ((dev->fh = open(filepath, O_RDWR)) < 1) {
-            syslog(LOG_ERR, "i2c: Failed to open requested i2c port %s", filepath);
+        dev->bus = mraa_i2c_bus_get(bus);
+        if (dev->bus == NULL) {
             status = MRAA_ERROR_NO_RESOURCES;
             goto init_internal_cleanup;
         }
-
-        if (ioctl(dev->fh, I2C_FUNCS, &dev->funcs) < 0) {
-            syslog(LOG_CRIT, "i2c: Failed to get I2C_FUNC map from device");
-            dev->funcs = 0;
-        }
+        dev->fh = dev->bus->fh;
+        dev->funcs = dev->bus->funcs;
     }
 
     if (IS_FUNC_DEFINED(dev, i2c_init_post)) {
@@ -121,8 +276,9 @@ init_internal_cleanup:
     if (status == MRAA_SUCCESS) {
         return dev;
 	} else {
-        if (dev != NULL)
-            free(dev);
+        if (dev->bus != NULL)
+            mraa_i2c_bus_put(dev->bus);
+        free(dev);
         return NULL;
    }
 }
@@ -204,8 +360,10 @@ mraa_i2c_read(mraa_i2c_context dev, uint8_t* data, int length)
     int bytes_read = 0;
     if (IS_FUNC_DEFINED(dev, i2c_read_replace))
         bytes_read = dev->advance_func->i2c_read_replace(dev, data, length);
-    else
+    else if (mraa_i2c_bus_lock(dev, 1) == MRAA_SUCCESS) {
         bytes_read = read(dev->fh, data, length);
+        mraa_i2c_bus_unlock(dev);
+    }
    if (bytes_read == length)
       return length;
    else
@@ -215,9 +373,11 @@ mraa_i2c_read(mraa_i2c_context dev, uint8_t* data, int length)
 uint8_t
 mraa_i2c_read_byte(mraa_i2c_context dev)
 {
+    if (IS_FUNC_DEFINED(dev, i2c_read_byte_replace))
+        return dev->advance_func->i2c_read_byte_replace(dev);
     i2c_smbus_data_t d;
 
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, I2C_NOCMD, I2C_SMBUS_BYTE, &d) < 0) {
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_READ, I2C_NOCMD, I2C_SMBUS_BYTE, &d) < 0) {
         syslog(LOG_ERR, "i2c: Failed to write");
         return 0;
     }
@@ -230,7 +390,7 @@ mraa_i2c_read_byte_data(mraa_i2c_context dev, uint8_t command)
     if (IS_FUNC_DEFINED(dev, i2c_read_byte_data_replace))
         return dev->advance_func->i2c_read_byte_data_replace(dev, command);
     i2c_smbus_data_t d;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c: Failed to write");
         return 0;
     }
@@ -240,9 +400,11 @@ mraa_i2c_read_byte_data(mraa_i2c_context dev, uint8_t command)
 uint16_t
 mraa_i2c_read_word_data(mraa_i2c_context dev, uint8_t command)
 {
+    if (IS_FUNC_DEFINED(dev, i2c_read_word_data_replace))
+        return dev->advance_func->i2c_read_word_data_replace(dev, command);
     i2c_smbus_data_t d;
 
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c: Failed to write");
         return 0;
     }
@@ -252,6 +414,8 @@ mraa_i2c_read_word_data(mraa_i2c_context dev, uint8_t command)
 int
 mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
 {
+    if (IS_FUNC_DEFINED(dev, i2c_read_bytes_data_replace))
+        return dev->advance_func->i2c_read_bytes_data_replace(dev, command, data, length);
     struct i2c_rdwr_ioctl_data d;
     struct i2c_msg m[2];
 
@@ -267,28 +431,380 @@ mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* data, i
     d.msgs = m;
     d.nmsgs = 2;
 
-    return ioctl(dev->fh, I2C_RDWR, &d) < 0 ? -1 : length;
+    mraa_i2c_bus_lock(dev, 0);
+    int ret = ioctl(dev->fh, I2C_RDWR, &d);
+    mraa_i2c_bus_unlock(dev);
+    return ret < 0 ? -1 : length;
+}
+
+/**
+ * Burst read the registers covered by fields, base is set to the first one
+ */
+static mraa_result_t
+mraa_i2c_read_field_regs(mraa_i2c_context dev, const mraa_i2c_field_t* fields, int count, uint8_t* buf, int* base)
+{
+    int first = 0xff;
+    int last = 0;
+    int i;
+
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (fields == NULL || count < 1) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    for (i = 0; i < count; i++) {
+        if (fields[i].width < 1 || fields[i].width > 4 || fields[i].reg + fields[i].width > 0x100) {
+            syslog(LOG_ERR, "i2c: field %d has an invalid width %d at register 0x%x", i, fields[i].width, fields[i].reg);
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+        if (fields[i].reg < first) {
+            first = fields[i].reg;
+        }
+        if (fields[i].reg + fields[i].width - 1 > last) {
+            last = fields[i].reg + fields[i].width - 1;
+        }
+    }
+
+    int length = last - first + 1;
+    if (mraa_i2c_read_bytes_data(dev, first, buf, length) != length) {
+        syslog(LOG_ERR, "i2c: Failed to read registers 0x%x to 0x%x", first, last);
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+    *base = first;
+    return MRAA_SUCCESS;
+}
+
+static int32_t
+mraa_i2c_decode_field(const mraa_i2c_field_t* field, const uint8_t* buf)
+{
+    uint32_t raw = 0;
+    int i;
+
+    for (i = 0; i < field->width; i++) {
+        if (field->flags & MRAA_I2C_FIELD_LITTLE_ENDIAN) {
+            raw |= (uint32_t) buf[i] << (8 * i);
+        } else {
+            raw = (raw << 8) | buf[i];
+        }
+    }
+    if ((field->flags & MRAA_I2C_FIELD_SIGNED) && field->width < 4 && (raw & (1u << (8 * field->width - 1)))) {
+        raw |= ~0u << (8 * field->width);
+    }
+    return (int32_t) raw;
+}
+
+static float
+mraa_i2c_scale_field(const mraa_i2c_field_t* field, int32_t value)
+{
+    float scale = field->scale == 0.0f ? 1.0f : field->scale;
+    if (field->flags & MRAA_I2C_FIELD_SIGNED) {
+        return value * scale;
+    }
+    return (uint32_t) value * scale;
 }
 
 mraa_result_t
-mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length)
+mraa_i2c_read_fields(mraa_i2c_context dev, const mraa_i2c_field_t* fields, int count, void* out)
 {
-    i2c_smbus_data_t d;
+    uint8_t buf[0x100];
+    int base;
     int i;
-    uint8_t command = data[0];
 
-    data = &data[1];
-    length = length - 1;
-    if (length > I2C_SMBUS_I2C_BLOCK_MAX) {
-        length = I2C_SMBUS_I2C_BLOCK_MAX;
+    if (out == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    mraa_result_t ret = mraa_i2c_read_field_regs(dev, fields, count, buf, &base);
+    if (ret != MRAA_SUCCESS) {
+        return ret;
+    }
+
+    for (i = 0; i < count; i++) {
+        int32_t value = mraa_i2c_decode_field(&fields[i], buf + fields[i].reg - base);
+        uint8_t* member = (uint8_t*) out + fields[i].offset;
+        if (fields[i].flags & MRAA_I2C_FIELD_FLOAT) {
+            float f = mraa_i2c_scale_field(&fields[i], value);
+            memcpy(member, &f, sizeof(f));
+        } else if (fields[i].width == 1) {
+            uint8_t v = (uint8_t) value;
+            memcpy(member, &v, sizeof(v));
+        } else if (fields[i].width == 2) {
+            uint16_t v = (uint16_t) value;
+            memcpy(member, &v, sizeof(v));
+        } else {
+            memcpy(member, &value, sizeof(value));
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_read_fields_float(mraa_i2c_context dev, const mraa_i2c_field_t* fields, int count, float* values)
+{
+    uint8_t buf[0x100];
+    int base;
+    int i;
+
+    if (values == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    mraa_result_t ret = mraa_i2c_read_field_regs(dev, fields, count, buf, &base);
+    if (ret != MRAA_SUCCESS) {
+        return ret;
+    }
+
+    for (i = 0; i < count; i++) {
+        values[i] = mraa_i2c_scale_field(&fields[i], mraa_i2c_decode_field(&fields[i], buf + fields[i].reg - base));
+    }
+    return MRAA_SUCCESS;
+}
+
+/**
+ * Run a validated message chain, without logging so that callers expecting
+ * a nack such as eeprom ack polling stay quiet
+ */
+static mraa_result_t
+mraa_i2c_rdwr(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int count)
+{
+    struct i2c_rdwr_ioctl_data d;
+    struct i2c_msg m[I2C_RDRW_IOCTL_MAX_MSGS];
+    int i;
+
+    if (IS_FUNC_DEFINED(dev, i2c_transfer_replace)) {
+        return dev->advance_func->i2c_transfer_replace(dev, msgs, count);
+    }
+    // funcs is 0 when the adapter could not be queried, let the ioctl decide
+    if (dev->funcs != 0 && !(dev->funcs & I2C_FUNC_I2C)) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    for (i = 0; i < count; i++) {
+        m[i].addr = msgs[i].addr;
+        m[i].flags = (msgs[i].flags & MRAA_I2C_MSG_READ) ? I2C_M_RD : 0;
+        m[i].len = msgs[i].len;
+        m[i].buf = (char*) msgs[i].buf;
+    }
+    d.msgs = m;
+    d.nmsgs = count;
+
+    mraa_i2c_bus_lock(dev, 0);
+    int ret = ioctl(dev->fh, I2C_RDWR, &d);
+    mraa_i2c_bus_unlock(dev);
+    return ret < 0 ? MRAA_ERROR_UNSPECIFIED : MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_transfer(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int count)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (msgs == NULL || count < 1 || count > I2C_RDRW_IOCTL_MAX_MSGS) {
+        syslog(LOG_ERR, "i2c: transfer needs between 1 and %d messages", I2C_RDRW_IOCTL_MAX_MSGS);
+        return MRAA_ERROR_INVALID_PARAMETER;
     }
 
+    mraa_result_t ret = mraa_i2c_rdwr(dev, msgs, count);
+    if (ret == MRAA_ERROR_FEATURE_NOT_SUPPORTED) {
+        syslog(LOG_ERR, "i2c: bus %d only supports smbus transfers", dev->busnum);
+    } else if (ret != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "i2c: transfer of %d messages failed", count);
+    }
+    return ret;
+}
+
+static mraa_result_t
+mraa_i2c_write_block(mraa_i2c_context dev, uint8_t command, const uint8_t* data, int length)
+{
+    i2c_smbus_data_t d;
+    int i;
+
     for (i = 1; i <= length; i++) {
         d.block[i] = data[i - 1];
     }
     d.block[0] = length;
 
-    return mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_I2C_BLOCK_DATA, &d);
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_I2C_BLOCK_DATA, &d) < 0) {
+        syslog(LOG_ERR, "i2c: Failed to write");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    return MRAA_SUCCESS;
+}
+
+/**
+ * Largest payload, prefix included, sent in one message on this context
+ */
+static int
+mraa_i2c_chunk_size(mraa_i2c_context dev)
+{
+    if (dev->max_transfer > 0 && dev->max_transfer < I2C_DEV_MSG_MAX) {
+        return dev->max_transfer;
+    }
+    return I2C_DEV_MSG_MAX;
+}
+
+/**
+ * Send prefix followed by data as one message to slave, prefix being the
+ * register or memory address
+ */
+static mraa_result_t
+mraa_i2c_write_msg(mraa_i2c_context dev, uint16_t slave, const uint8_t* prefix, int prefix_len, const uint8_t* data, int length)
+{
+    uint8_t small[64];
+    uint8_t* buf = small;
+    mraa_i2c_msg_t m;
+
+    if (prefix_len + length > (int) sizeof(small)) {
+        buf = (uint8_t*) malloc(prefix_len + length);
+        if (buf == NULL) {
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+    }
+    memcpy(buf, prefix, prefix_len);
+    if (length > 0) {
+        memcpy(buf + prefix_len, data, length);
+    }
+    m.addr = slave;
+    m.flags = MRAA_I2C_MSG_WRITE;
+    m.len = prefix_len + length;
+    m.buf = buf;
+
+    mraa_result_t ret = mraa_i2c_rdwr(dev, &m, 1);
+    if (buf != small) {
+        free(buf);
+    }
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (IS_FUNC_DEFINED(dev, i2c_write_replace)) {
+        return dev->advance_func->i2c_write_replace(dev, data, length);
+    }
+    if (data == NULL || length < 1) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    uint8_t command = data[0];
+    data = &data[1];
+    length = length - 1;
+
+    // short writes keep using the smbus block call every adapter supports
+    if (length <= I2C_SMBUS_I2C_BLOCK_MAX) {
+        return mraa_i2c_write_block(dev, command, data, length);
+    }
+
+    // longer ones are split. Each piece repeats the first byte, which is
+    // what control byte protocols such as the SSD1306 0x40 data prefix
+    // want, unless the caller asked for each to start at the register
+    // where the previous one ended
+    if (dev->auto_increment && command + length - 1 > 0xff) {
+        syslog(LOG_ERR, "i2c: write of %d bytes at register 0x%x runs past 0xff", length, command);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    int smbus_only = dev->funcs != 0 && !(dev->funcs & I2C_FUNC_I2C);
+    int chunk = smbus_only ? I2C_SMBUS_I2C_BLOCK_MAX : mraa_i2c_chunk_size(dev) - 1;
+    int offset;
+    for (offset = 0; offset < length; offset += chunk) {
+        int len = (length - offset < chunk) ? length - offset : chunk;
+        uint8_t reg = dev->auto_increment ? command + offset : command;
+        mraa_result_t ret;
+        if (smbus_only) {
+            ret = mraa_i2c_write_block(dev, reg, data + offset, len);
+        } else {
+            ret = mraa_i2c_write_msg(dev, dev->addr, &reg, 1, data + offset, len);
+        }
+        if (ret != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "i2c: Failed to write %d bytes at register 0x%x", len, reg);
+            return ret;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_set_max_transfer(mraa_i2c_context dev, int max)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    // room for a two byte address and at least one data byte
+    if (max != 0 && (max < 3 || max > I2C_DEV_MSG_MAX)) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    dev->max_transfer = max;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_set_auto_increment(mraa_i2c_context dev, mraa_boolean_t enable)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    dev->auto_increment = enable ? 1 : 0;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_write_eeprom(mraa_i2c_context dev, unsigned int offset, int addr_bytes, int page_size, const uint8_t* data, int length)
+{
+    uint8_t prefix[2];
+    int i;
+
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (data == NULL || length < 0 || page_size < 8 || page_size > 256 || (addr_bytes != 1 && addr_bytes != 2)) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    int max = mraa_i2c_chunk_size(dev) - addr_bytes;
+    int written = 0;
+    while (written < length) {
+        unsigned int mem = offset + written;
+        int len = page_size - (mem % page_size);
+        if (len > length - written) {
+            len = length - written;
+        }
+        if (len > max) {
+            len = max;
+        }
+
+        // address bits above the address bytes go in the slave address,
+        // A8-A10 on the 24C04-24C16 and A16 on the 24CM01
+        uint16_t slave = dev->addr | ((mem >> (8 * addr_bytes)) & 0x7);
+        if (addr_bytes == 2) {
+            prefix[0] = (mem >> 8) & 0xff;
+            prefix[1] = mem & 0xff;
+        } else {
+            prefix[0] = mem & 0xff;
+        }
+
+        mraa_result_t ret = mraa_i2c_write_msg(dev, slave, prefix, addr_bytes, data + written, len);
+        if (ret != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "i2c: eeprom at 0x%x refused a write at 0x%x", slave, mem);
+            return ret;
+        }
+
+        // the device nacks until its write cycle is over
+        for (i = 0; i < EEPROM_ACK_POLLS; i++) {
+            usleep(EEPROM_ACK_POLL_US);
+            if (mraa_i2c_write_msg(dev, slave, prefix, addr_bytes, NULL, 0) == MRAA_SUCCESS) {
+                break;
+            }
+        }
+        if (i == EEPROM_ACK_POLLS) {
+            syslog(LOG_ERR, "i2c: eeprom at 0x%x did not finish writing 0x%x", slave, mem);
+            return MRAA_ERROR_UNSPECIFIED;
+        }
+        written += len;
+    }
+    return MRAA_SUCCESS;
 }
 
 mraa_result_t
@@ -297,7 +813,7 @@ mraa_i2c_write_byte(mraa_i2c_context dev, const uint8_t data)
     if (IS_FUNC_DEFINED(dev, i2c_write_byte_replace)) {
         return dev->advance_func->i2c_write_byte_replace(dev, data);
     } else {
-        if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) < 0) {
+        if (mraa_i2c_smbus(dev, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) < 0) {
             syslog(LOG_ERR, "i2c: Failed to write");
             return MRAA_ERROR_INVALID_HANDLE;
         }
@@ -312,7 +828,7 @@ mraa_i2c_write_byte_data(mraa_i2c_context dev, const uint8_t data, const uint8_t
         return dev->advance_func->i2c_write_byte_data_replace(dev, data, command);
     i2c_smbus_data_t d;
     d.byte = data;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c: Failed to write");
         return MRAA_ERROR_INVALID_HANDLE;
     }
@@ -326,7 +842,7 @@ mraa_i2c_write_word_data(mraa_i2c_context dev, const uint16_t data, const uint8_
         return dev->advance_func->i2c_write_word_data_replace(dev, data, command);
     i2c_smbus_data_t d;
     d.word = data;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
+    if (mraa_i2c_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c: Failed to write");
         return MRAA_ERROR_INVALID_HANDLE;
     }
@@ -343,19 +859,198 @@ mraa_i2c_address(mraa_i2c_context dev, uint8_t addr)
     dev->addr = (int) addr;
     if (IS_FUNC_DEFINED(dev, i2c_address_replace)) {
         return dev->advance_func->i2c_address_replace(dev, addr);
-    } else {
-        if (ioctl(dev->fh, I2C_SLAVE_FORCE, addr) < 0) {
-            syslog(LOG_ERR, "i2c: Failed to set slave address %d", addr);
-            return MRAA_ERROR_INVALID_HANDLE;
+    }
+    // applied now so a bad address is reported here, later accesses only
+    // switch the kernel's slave address again if another context moved it
+    mraa_result_t ret = mraa_i2c_bus_lock(dev, 1);
+    if (ret == MRAA_SUCCESS) {
+        mraa_i2c_bus_unlock(dev);
+    }
+    return ret;
+}
+
+
+/**
+ * Probe one address the way i2cdetect does in its default mode
+ */
+static mraa_boolean_t
+mraa_i2c_probe(mraa_i2c_context dev, int addr)
+{
+    i2c_smbus_data_t d;
+    uint8_t byte;
+    mraa_i2c_msg_t m;
+
+    if (dev->bus == NULL) {
+        // replaced bus, the only primitive left is a message
+        m.addr = addr;
+        m.flags = MRAA_I2C_MSG_READ;
+        m.len = 1;
+        m.buf = &byte;
+        return mraa_i2c_rdwr(dev, &m, 1) == MRAA_SUCCESS;
+    }
+
+    dev->addr = addr;
+    // a quick write can corrupt eeproms and lock up some sensors
+    mraa_boolean_t eeprom = (addr >= 0x30 && addr <= 0x37) || (addr >= 0x50 && addr <= 0x5f);
+    if (!eeprom && (dev->funcs & I2C_FUNC_SMBUS_QUICK)) {
+        return mraa_i2c_smbus(dev, I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, NULL) >= 0;
+    }
+    return mraa_i2c_smbus(dev, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &d) >= 0;
+}
+
+static mraa_result_t
+mraa_i2c_scan_uncached(int bus, uint8_t* bitmap)
+{
+    mraa_i2c_scan_t* scan;
+    int addr;
+
+    mraa_i2c_context dev = mraa_i2c_init(bus);
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    memset(bitmap, 0, MRAA_I2C_SCAN_BYTES);
+    for (addr = SCAN_FIRST; addr <= SCAN_LAST; addr++) {
+        if (mraa_i2c_probe(dev, addr)) {
+            bitmap[addr / 8] |= 1 << (addr % 8);
         }
+    }
+    mraa_i2c_stop(dev);
+
+    pthread_mutex_lock(&scans_lock);
+    for (scan = scans; scan != NULL && scan->bus != bus; scan = scan->next)
+        ;
+    if (scan == NULL) {
+        scan = (mraa_i2c_scan_t*) malloc(sizeof(mraa_i2c_scan_t));
+        if (scan != NULL) {
+            scan->bus = bus;
+            scan->next = scans;
+            scans = scan;
+        }
+    }
+    // without memory the scan is just not cached
+    if (scan != NULL) {
+        memcpy(scan->bitmap, bitmap, MRAA_I2C_SCAN_BYTES);
+    }
+    pthread_mutex_unlock(&scans_lock);
+    return MRAA_SUCCESS;
+}
+
+static mraa_boolean_t
+mraa_i2c_scan_cached(int bus, uint8_t* bitmap)
+{
+    mraa_i2c_scan_t* scan;
+
+    pthread_mutex_lock(&scans_lock);
+    for (scan = scans; scan != NULL && scan->bus != bus; scan = scan->next)
+        ;
+    if (scan != NULL) {
+        memcpy(bitmap, scan->bitmap, MRAA_I2C_SCAN_BYTES);
+    }
+    pthread_mutex_unlock(&scans_lock);
+    return scan != NULL;
+}
+
+mraa_result_t
+mraa_i2c_scan(int bus, uint8_t* bitmap)
+{
+    if (bitmap == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    if (mraa_i2c_scan_cached(bus, bitmap)) {
         return MRAA_SUCCESS;
     }
+    return mraa_i2c_scan_uncached(bus, bitmap);
 }
 
+static void*
+mraa_i2c_scan_thread(void* arg)
+{
+    mraa_i2c_scan_job_t* job = (mraa_i2c_scan_job_t*) arg;
+    job->result = mraa_i2c_scan_uncached(job->bus, job->bitmap);
+    return NULL;
+}
+
+mraa_result_t
+mraa_i2c_scan_buses(const int* buses, int count, uint8_t* bitmaps)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+    int i;
+
+    if (buses == NULL || bitmaps == NULL || count < 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    mraa_i2c_scan_job_t* jobs = (mraa_i2c_scan_job_t*) calloc(count, sizeof(mraa_i2c_scan_job_t));
+    pthread_t* threads = (pthread_t*) calloc(count, sizeof(pthread_t));
+    mraa_boolean_t* started = (mraa_boolean_t*) calloc(count, sizeof(mraa_boolean_t));
+    if (count > 0 && (jobs == NULL || threads == NULL || started == NULL)) {
+        syslog(LOG_CRIT, "i2c: scan: Failed to allocate memory for scan threads");
+        free(jobs);
+        free(threads);
+        free(started);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    for (i = 0; i < count; i++) {
+        jobs[i].bus = buses[i];
+        jobs[i].bitmap = bitmaps + i * MRAA_I2C_SCAN_BYTES;
+        jobs[i].result = MRAA_SUCCESS;
+        if (mraa_i2c_scan_cached(buses[i], jobs[i].bitmap)) {
+            continue;
+        }
+        // fall back to scanning from this thread if no thread is available
+        if (pthread_create(&threads[i], NULL, mraa_i2c_scan_thread, &jobs[i]) == 0) {
+            started[i] = 1;
+        } else {
+            mraa_i2c_scan_thread(&jobs[i]);
+        }
+    }
+    for (i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        if (ret == MRAA_SUCCESS) {
+            ret = jobs[i].result;
+        }
+    }
+
+    free(jobs);
+    free(threads);
+    free(started);
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_scan_invalidate(int bus)
+{
+    mraa_i2c_scan_t** pos;
+    mraa_i2c_scan_t* scan;
+
+    pthread_mutex_lock(&scans_lock);
+    pos = &scans;
+    while (*pos != NULL) {
+        scan = *pos;
+        if (bus == -1 || scan->bus == bus) {
+            *pos = scan->next;
+            free(scan);
+        } else {
+            pos = &scan->next;
+        }
+    }
+    pthread_mutex_unlock(&scans_lock);
+    return MRAA_SUCCESS;
+}
 
 mraa_result_t
 mraa_i2c_stop(mraa_i2c_context dev)
 {
+    mraa_result_t status = mraa_i2c_queue_release(dev);
+    if (status != MRAA_SUCCESS) {
+        return status;
+    }
+    if (dev->bus != NULL) {
+        mraa_i2c_bus_put(dev->bus);
+    }
     free(dev);
     return MRAA_SUCCESS;
 }
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "i2c.h"
+#include "mraa_internal.h"
+#include "i2c/i2c_queue.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef struct _i2c_queue {
+    int busnum; /**< bus served by this worker */
+    mraa_adv_func_t* advance_func; /**< platform the bus belongs to */
+    int refs; /**< contexts that submitted at least once */
+    mraa_boolean_t stop; /**< worker should exit */
+    pthread_t thread; /**< worker thread */
+    pthread_mutex_t lock; /**< protects head, stop and the pending counts */
+    pthread_cond_t work; /**< signalled when head or stop changes */
+    pthread_cond_t done; /**< broadcast when a transaction completes */
+    mraa_i2c_transaction_t* head; /**< waiting transactions, highest priority first */
+    mraa_i2c_transaction_t* running; /**< transaction in its callback, NULL once resubmitted */
+    struct _i2c_queue* next; /**< list of running workers */
+} mraa_i2c_queue_t;
+
+static pthread_mutex_t queues_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_i2c_queue_t* queues = NULL;
+
+static void*
+mraa_i2c_queue_worker(void* arg)
+{
+    mraa_i2c_queue_t* queue = (mraa_i2c_queue_t*) arg;
+    mraa_i2c_transaction_t* transaction;
+    mraa_i2c_callback_t callback;
+    mraa_i2c_context dev;
+    void* args;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (queue->head == NULL && !queue->stop) {
+            pthread_cond_wait(&queue->work, &queue->lock);
+        }
+        if (queue->head == NULL) {
+            break;
+        }
+        transaction = queue->head;
+        queue->head = transaction->next;
+        pthread_mutex_unlock(&queue->lock);
+
+        dev = transaction->dev;
+        callback = transaction->callback;
+        args = transaction->args;
+        transaction->result = mraa_i2c_transfer(dev, transaction->msgs, transaction->count);
+
+        // the callback runs before complete is set, so a waiter can't free
+        // the transaction under it. It may resubmit it, which clears running
+        if (callback != NULL) {
+            pthread_mutex_lock(&queue->lock);
+            queue->running = transaction;
+            pthread_mutex_unlock(&queue->lock);
+            callback(transaction, args);
+        }
+
+        // once complete is set the transaction belongs to the caller again
+        // and may be freed or resubmitted, only the saved copies are used
+        pthread_mutex_lock(&queue->lock);
+        if (callback == NULL || queue->running == transaction) {
+            transaction->complete = 1;
+        }
+        queue->running = NULL;
+        dev->pending--;
+        pthread_cond_broadcast(&queue->done);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static mraa_i2c_queue_t*
+mraa_i2c_queue_get(mraa_i2c_context dev)
+{
+    mraa_i2c_queue_t* queue;
+
+    pthread_mutex_lock(&queues_lock);
+    for (queue = queues; queue != NULL; queue = queue->next) {
+        if (queue->busnum == dev->busnum && queue->advance_func == dev->advance_func) {
+            queue->refs++;
+            pthread_mutex_unlock(&queues_lock);
+            return queue;
+        }
+    }
+
+    queue = (mraa_i2c_queue_t*) calloc(1, sizeof(mraa_i2c_queue_t));
+    if (queue == NULL) {
+        syslog(LOG_CRIT, "i2c%i: submit: Failed to allocate memory for bus worker", dev->busnum);
+        pthread_mutex_unlock(&queues_lock);
+        return NULL;
+    }
+    queue->busnum = dev->busnum;
+    queue->advance_func = dev->advance_func;
+    queue->refs = 1;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->work, NULL);
+    pthread_cond_init(&queue->done, NULL);
+    if (pthread_create(&queue->thread, NULL, mraa_i2c_queue_worker, queue) != 0) {
+        syslog(LOG_ERR, "i2c%i: submit: Failed to start bus worker thread", dev->busnum);
+        pthread_cond_destroy(&queue->done);
+        pthread_cond_destroy(&queue->work);
+        pthread_mutex_destroy(&queue->lock);
+        free(queue);
+        pthread_mutex_unlock(&queues_lock);
+        return NULL;
+    }
+    queue->next = queues;
+    queues = queue;
+    pthread_mutex_unlock(&queues_lock);
+    return queue;
+}
+
+mraa_result_t
+mraa_i2c_submit(mraa_i2c_context dev, mraa_i2c_transaction_t* transaction, mraa_i2c_callback_t callback, void* args)
+{
+    mraa_i2c_transaction_t** pos;
+    mraa_i2c_queue_t* queue;
+
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: submit: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (transaction == NULL || transaction->msgs == NULL || transaction->count <= 0) {
+        syslog(LOG_ERR, "i2c%i: submit: invalid transaction", dev->busnum);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (dev->queue == NULL) {
+        dev->queue = mraa_i2c_queue_get(dev);
+        if (dev->queue == NULL) {
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+    }
+    queue = dev->queue;
+
+    transaction->dev = dev;
+    transaction->callback = callback;
+    transaction->args = args;
+    transaction->result = MRAA_SUCCESS;
+    transaction->complete = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->running == transaction) {
+        // resubmitted from its own callback, it is not complete any more
+        queue->running = NULL;
+    }
+    // behind every transaction of the same or higher priority
+    for (pos = &queue->head; *pos != NULL && (*pos)->priority >= transaction->priority; pos = &(*pos)->next)
+        ;
+    transaction->next = *pos;
+    *pos = transaction;
+    dev->pending++;
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->lock);
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_wait(mraa_i2c_transaction_t* transaction)
+{
+    mraa_i2c_queue_t* queue;
+
+    if (transaction == NULL || transaction->dev == NULL || transaction->dev->queue == NULL) {
+        syslog(LOG_ERR, "i2c: wait: transaction was never submitted");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    queue = transaction->dev->queue;
+
+    pthread_mutex_lock(&queue->lock);
+    if (!transaction->complete && pthread_equal(queue->thread, pthread_self())) {
+        pthread_mutex_unlock(&queue->lock);
+        syslog(LOG_ERR, "i2c%i: wait: called from a completion callback", queue->busnum);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    while (!transaction->complete) {
+        pthread_cond_wait(&queue->done, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return transaction->result;
+}
+
+mraa_result_t
+mraa_i2c_drain(mraa_i2c_context dev)
+{
+    mraa_i2c_queue_t* queue;
+
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: drain: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    queue = dev->queue;
+    if (queue == NULL) {
+        return MRAA_SUCCESS;
+    }
+
+    if (pthread_equal(queue->thread, pthread_self())) {
+        syslog(LOG_ERR, "i2c%i: drain: called from a completion callback", dev->busnum);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    while (dev->pending > 0) {
+        pthread_cond_wait(&queue->done, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_queue_release(mraa_i2c_context dev)
+{
+    mraa_i2c_queue_t* queue = dev->queue;
+    mraa_i2c_queue_t** pos;
+    mraa_result_t status;
+
+    if (queue == NULL) {
+        return MRAA_SUCCESS;
+    }
+
+    status = mraa_i2c_drain(dev);
+    if (status != MRAA_SUCCESS) {
+        return status;
+    }
+    dev->queue = NULL;
+
+    pthread_mutex_lock(&queues_lock);
+    if (--queue->refs > 0) {
+        pthread_mutex_unlock(&queues_lock);
+        return MRAA_SUCCESS;
+    }
+    for (pos = &queues; *pos != queue; pos = &(*pos)->next)
+        ;
+    *pos = queue->next;
+    pthread_mutex_unlock(&queues_lock);
+
+    pthread_mutex_lock(&queue->lock);
+    queue->stop = 1;
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->thread, NULL);
+
+    pthread_cond_destroy(&queue->done);
+    pthread_cond_destroy(&queue->work);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+    return MRAA_SUCCESS;
+}
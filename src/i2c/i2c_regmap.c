@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "i2c.h"
+#include "mraa_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "linux/i2c-dev.h"
+
+#define REGMAP_MAX_REGS 256
+// per register state, the low bits are the mraa_i2c_reg_flags_t of its range
+#define REG_FLAGS_MASK (MRAA_I2C_REG_VOLATILE | MRAA_I2C_REG_READ_ONLY)
+#define REG_VALID 0x10
+#define REG_DIRTY 0x20
+
+static void
+mraa_i2c_regmap_encode(mraa_i2c_regmap_context map, unsigned int value, uint8_t* buf)
+{
+    int i;
+    for (i = map->val_bytes - 1; i >= 0; i--) {
+        buf[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+static unsigned int
+mraa_i2c_regmap_decode(mraa_i2c_regmap_context map, const uint8_t* buf)
+{
+    unsigned int value = 0;
+    int i;
+    for (i = 0; i < map->val_bytes; i++) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+static mraa_result_t
+mraa_i2c_regmap_bus_read(mraa_i2c_regmap_context map, uint8_t reg, unsigned int* value)
+{
+    uint8_t buf[2];
+    mraa_i2c_msg_t m[2];
+
+    m[0].addr = map->addr;
+    m[0].flags = MRAA_I2C_MSG_WRITE;
+    m[0].len = 1;
+    m[0].buf = &reg;
+    m[1].addr = map->addr;
+    m[1].flags = MRAA_I2C_MSG_READ;
+    m[1].len = map->val_bytes;
+    m[1].buf = buf;
+
+    mraa_result_t ret = mraa_i2c_transfer(map->i2c, m, 2);
+    if (ret == MRAA_SUCCESS) {
+        *value = mraa_i2c_regmap_decode(map, buf);
+    }
+    return ret;
+}
+
+static mraa_result_t
+mraa_i2c_regmap_bus_write(mraa_i2c_regmap_context map, uint8_t reg, unsigned int value)
+{
+    uint8_t buf[3];
+    mraa_i2c_msg_t m;
+
+    buf[0] = reg;
+    mraa_i2c_regmap_encode(map, value, &buf[1]);
+    m.addr = map->addr;
+    m.flags = MRAA_I2C_MSG_WRITE;
+    m.len = 1 + map->val_bytes;
+    m.buf = buf;
+    return mraa_i2c_transfer(map->i2c, &m, 1);
+}
+
+mraa_i2c_regmap_context
+mraa_i2c_regmap_init(mraa_i2c_context i2c, uint8_t address, int val_bytes, int num_regs, const mraa_i2c_reg_range_t* ranges, int num_ranges)
+{
+    int i, reg;
+
+    if (i2c == NULL) {
+        syslog(LOG_ERR, "i2c regmap: invalid i2c context");
+        return NULL;
+    }
+    if ((val_bytes != 1 && val_bytes != 2) || num_regs < 1 || num_regs > REGMAP_MAX_REGS ||
+        num_ranges < 0 || (num_ranges > 0 && ranges == NULL)) {
+        syslog(LOG_ERR, "i2c regmap: invalid register layout");
+        return NULL;
+    }
+    // bursts need plain i2c messages, smbus register calls can't carry them
+    if (i2c->funcs != 0 && !(i2c->funcs & I2C_FUNC_I2C) && !IS_FUNC_DEFINED(i2c, i2c_transfer_replace)) {
+        syslog(LOG_ERR, "i2c regmap: bus %d only supports smbus transfers", i2c->busnum);
+        return NULL;
+    }
+
+    mraa_i2c_regmap_context map = (mraa_i2c_regmap_context) calloc(1, sizeof(struct _i2c_regmap));
+    if (map == NULL) {
+        syslog(LOG_CRIT, "i2c regmap: Failed to allocate memory for context");
+        return NULL;
+    }
+    map->i2c = i2c;
+    map->addr = address;
+    map->val_bytes = val_bytes;
+    map->num_regs = num_regs;
+    map->cache = (unsigned int*) calloc(num_regs, sizeof(unsigned int));
+    map->state = (uint8_t*) calloc(num_regs, sizeof(uint8_t));
+    if (map->cache == NULL || map->state == NULL) {
+        syslog(LOG_CRIT, "i2c regmap: Failed to allocate memory for cache");
+        mraa_i2c_regmap_stop(map);
+        return NULL;
+    }
+
+    for (i = 0; i < num_ranges; i++) {
+        for (reg = ranges[i].first; reg <= ranges[i].last && reg < num_regs; reg++) {
+            map->state[reg] |= ranges[i].flags & REG_FLAGS_MASK;
+        }
+    }
+    return map;
+}
+
+mraa_result_t
+mraa_i2c_regmap_read(mraa_i2c_regmap_context map, uint8_t reg, unsigned int* value)
+{
+    if (map == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (reg >= map->num_regs || value == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    uint8_t state = map->state[reg];
+    if (state & REG_VALID) {
+        *value = map->cache[reg];
+        return MRAA_SUCCESS;
+    }
+
+    mraa_result_t ret = mraa_i2c_regmap_bus_read(map, reg, value);
+    if (ret == MRAA_SUCCESS && !(state & MRAA_I2C_REG_VOLATILE)) {
+        map->cache[reg] = *value;
+        map->state[reg] |= REG_VALID;
+    }
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_regmap_write(mraa_i2c_regmap_context map, uint8_t reg, unsigned int value)
+{
+    if (map == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (reg >= map->num_regs) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    uint8_t state = map->state[reg];
+    if (state & MRAA_I2C_REG_READ_ONLY) {
+        syslog(LOG_ERR, "i2c regmap: register 0x%x is read only", reg);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    value &= (map->val_bytes == 1) ? 0xff : 0xffff;
+
+    if (state & MRAA_I2C_REG_VOLATILE) {
+        return mraa_i2c_regmap_bus_write(map, reg, value);
+    }
+    if ((state & REG_VALID) && map->cache[reg] == value) {
+        return MRAA_SUCCESS;
+    }
+    map->cache[reg] = value;
+    map->state[reg] |= REG_VALID | REG_DIRTY;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_regmap_update_bits(mraa_i2c_regmap_context map, uint8_t reg, unsigned int mask, unsigned int value)
+{
+    unsigned int old;
+
+    mraa_result_t ret = mraa_i2c_regmap_read(map, reg, &old);
+    if (ret != MRAA_SUCCESS) {
+        return ret;
+    }
+    return mraa_i2c_regmap_write(map, reg, (old & ~mask) | (value & mask));
+}
+
+/**
+ * Send a batch of bursts and clear the dirty bit of the registers they carry
+ */
+static mraa_result_t
+mraa_i2c_regmap_flush(mraa_i2c_regmap_context map, mraa_i2c_msg_t* msgs, int count)
+{
+    int i, reg;
+
+    mraa_result_t ret = mraa_i2c_transfer(map->i2c, msgs, count);
+    if (ret != MRAA_SUCCESS) {
+        return ret;
+    }
+    for (i = 0; i < count; i++) {
+        int first = msgs[i].buf[0];
+        int last = first + (msgs[i].len - 1) / map->val_bytes;
+        for (reg = first; reg < last; reg++) {
+            map->state[reg] &= ~REG_DIRTY;
+        }
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_regmap_sync(mraa_i2c_regmap_context map)
+{
+    mraa_i2c_msg_t msgs[I2C_RDRW_IOCTL_MAX_MSGS];
+    int count = 0;
+    int reg;
+
+    if (map == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    // longest burst allowed by the context max transfer size
+    int max_run = map->num_regs;
+    if (map->i2c->max_transfer > 0 && (map->i2c->max_transfer - 1) / map->val_bytes < max_run) {
+        max_run = (map->i2c->max_transfer - 1) / map->val_bytes;
+    }
+
+    // room for a register byte per burst and every value
+    uint8_t* buf = (uint8_t*) malloc(map->num_regs * (map->val_bytes + 1));
+    if (buf == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    uint8_t* pos = buf;
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    reg = 0;
+    while (reg < map->num_regs) {
+        if (!(map->state[reg] & REG_DIRTY)) {
+            reg++;
+            continue;
+        }
+
+        int run = 0;
+        msgs[count].addr = map->addr;
+        msgs[count].flags = MRAA_I2C_MSG_WRITE;
+        msgs[count].buf = pos;
+        *pos++ = reg;
+        while (reg < map->num_regs && (map->state[reg] & REG_DIRTY) && run < max_run) {
+            mraa_i2c_regmap_encode(map, map->cache[reg], pos);
+            pos += map->val_bytes;
+            reg++;
+            run++;
+        }
+        msgs[count].len = 1 + run * map->val_bytes;
+        count++;
+
+        if (count == I2C_RDRW_IOCTL_MAX_MSGS) {
+            ret = mraa_i2c_regmap_flush(map, msgs, count);
+            if (ret != MRAA_SUCCESS) {
+                break;
+            }
+            count = 0;
+            pos = buf;
+        }
+    }
+    if (ret == MRAA_SUCCESS && count > 0) {
+        ret = mraa_i2c_regmap_flush(map, msgs, count);
+    }
+
+    free(buf);
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_regmap_invalidate(mraa_i2c_regmap_context map)
+{
+    int reg;
+
+    if (map == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    for (reg = 0; reg < map->num_regs; reg++) {
+        map->state[reg] &= REG_FLAGS_MASK;
+    }
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_regmap_stop(mraa_i2c_regmap_context map)
+{
+    if (map == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    free(map->cache);
+    free(map->state);
+    free(map);
+    return MRAA_SUCCESS;
+}
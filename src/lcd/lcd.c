@@ -481,14 +481,14 @@ mraa_lcd_write(mraa_lcd_context dev, const char* buf, size_t len)
     system('echo -e "\e[0;0H" > /dev/tty0');*/
 }
 
-unsigned char * mraa_lcd_getjpg(mraa_lcd_context dev,char * filename, int *w, int *h)
+unsigned char * mraa_lcd_getjpg(mraa_lcd_context dev,const unsigned char * filename, int *w, int *h)
 {
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
 	FILE           *infile;
 	unsigned char  *buffer;
 	unsigned char *temp;
-	if ((infile = fopen(filename, "rb")) == NULL) {
+	if ((infile = fopen((const char*) filename, "rb")) == NULL) {
 		fprintf(stderr, "open %s failed/n", filename);
 		exit(-1);
 	}
@@ -23,14 +23,20 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
 #include <mraa/common.h>
 
 #include "mraa_internal.h"
+#include "gpio/gpio_dispatch.h"
+#include "mmap/mmap_soc.h"
 
 #include "common.h"
 
@@ -43,56 +49,293 @@
 #define MT7628_GPIO_DATA		0x620
 #define MT7628_GPIO_SET			0x630
 #define MT7628_GPIO_CLEAR		0x640
+#define MT7628_GPIO_BANKS		3
+#define MT7628_PWM_BASE			0x10005000
+#define MT7628_PWM_ENABLE		0x000
+#define MT7628_PWM_CON(ch)		(0x010 + (ch) * 0x40)
+#define MT7628_PWM_CON_OLD_MODE		(1 << 15)
+#define MT7628_PWM_CON_CLKSEL		(1 << 3)
+#define MT7628_PWM_DWIDTH(ch)		(0x03c + (ch) * 0x40)
+#define MT7628_PWM_THRESH(ch)		(0x040 + (ch) * 0x40)
+#define MT7628_PWM_CHANNELS		4
+#define MT7628_PWM_CLOCK		40000000
+#define MT7628_PWM_MAX_COUNT		0x1fff
 
 #define MAX_SIZE 64
 
-// MMAP
-static uint8_t* mmap_reg = NULL;
-static int mmap_fd = 0;
-static int mmap_size;
-static uint8_t* gpio_mmap_reg = NULL;
-static int gpio_mmap_fd = 0;
-static int gpio_mmap_size;
-static unsigned int mmap_count = 0;
+// MMAP, the gpio and pin mode registers share the system control block
+static mraa_mmap_region_t gpio_region;
+static mraa_mmap_region_t gpiomode_region = MRAA_MMAP_REGION(MMAP_PATH, MT7628_GPIOMODE_BASE, MT7628_BLOCK_SIZE);
+static mraa_mmap_region_t pwm_region = MRAA_MMAP_REGION(MMAP_PATH, MT7628_PWM_BASE, MT7628_BLOCK_SIZE);
 static int platform_detected = 0;
 
 mraa_result_t
 mraa_mtk_linkit_mmap_write(mraa_gpio_context dev, int value)
 {
-    volatile uint32_t* addr;
-    if (value) {
-        *(volatile uint32_t*) (mmap_reg + MT7628_GPIO_SET + (dev->pin / 32) * 4) =
-        (uint32_t)(1 << (dev->pin % 32));
-    } else {
-        *(volatile uint32_t*) (mmap_reg + MT7628_GPIO_CLEAR + (dev->pin / 32) * 4) =
-        (uint32_t)(1 << (dev->pin % 32));
+    return mraa_mmap_soc_gpio_write(&mraa_mmap_soc_mt7628, &gpio_region, dev->pin, value);
+}
+
+int
+mraa_mtk_linkit_mmap_read(mraa_gpio_context dev)
+{
+    return mraa_mmap_soc_gpio_read(&mraa_mmap_soc_mt7628, &gpio_region, dev->pin);
+}
+
+static mraa_result_t
+mraa_mtk_linkit_sysfs_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
+{
+    char filepath[PATH_MAX];
+    if (mraa_sysfs_path(filepath, sizeof(filepath), "/sys/class/gpio/gpio%d/direction", dev->pin) >= (int) sizeof(filepath)) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    const char* bu;
+    switch (dir) {
+        case MRAA_GPIO_OUT:
+            bu = "out";
+            break;
+        case MRAA_GPIO_IN:
+            bu = "in";
+            break;
+        case MRAA_GPIO_OUT_HIGH:
+            bu = "high";
+            break;
+        case MRAA_GPIO_OUT_LOW:
+            bu = "low";
+            break;
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
     }
+    mraa_boolean_t cache = dir == MRAA_GPIO_OUT || dir == MRAA_GPIO_IN;
+    return mraa_sysfs_attr_write(&dev->direction, filepath, bu, strlen(bu), cache);
+}
+
+mraa_result_t
+mraa_mtk_linkit_gpio_dir_replace(mraa_gpio_context dev, mraa_gpio_dir_t dir)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (gpio_region.base == NULL || dev->mmap_write == NULL) {
+        return mraa_mtk_linkit_sysfs_dir(dev, dir);
+    }
+
+    uint32_t ctrl = MT7628_GPIO_CTRL + (dev->pin / 32) * 4;
+    uint32_t bit = (uint32_t)(1 << (dev->pin % 32));
+    switch (dir) {
+        case MRAA_GPIO_OUT_HIGH:
+            mraa_mtk_linkit_mmap_write(dev, 1);
+            break;
+        case MRAA_GPIO_OUT_LOW:
+            mraa_mtk_linkit_mmap_write(dev, 0);
+            break;
+        case MRAA_GPIO_OUT:
+        case MRAA_GPIO_IN:
+            break;
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+    // the bank's other pins share CTRL, update it under the mapping lock
+    mraa_mmap_update32(&gpio_region, ctrl, bit, dir == MRAA_GPIO_IN ? 0 : bit);
+    // sysfs no longer knows the direction, don't skip the next write there
+    dev->direction.length = -1;
     return MRAA_SUCCESS;
 }
 
 static mraa_result_t
-mraa_mtk_linkit_mmap_unsetup()
+mraa_mtk_linkit_mmap_bank_write(unsigned int bank, uint32_t mask, uint32_t value)
 {
-    if (mmap_reg == NULL) {
-        syslog(LOG_ERR, "linkit mmap: null register cant unsetup");
-        return MRAA_ERROR_INVALID_RESOURCE;
+    return mraa_mmap_soc_bank_write(&mraa_mmap_soc_mt7628, &gpio_region, bank, mask, value);
+}
+
+static mraa_result_t
+mraa_mtk_linkit_mmap_bank_read(unsigned int bank, uint32_t* value)
+{
+    return mraa_mmap_soc_bank_read(&mraa_mmap_soc_mt7628, &gpio_region, bank, value);
+}
+
+static mraa_result_t
+mraa_mtk_linkit_mmap_bank_setup(unsigned int bank, mraa_boolean_t en)
+{
+    return mraa_mmap_soc_bank_setup(&mraa_mmap_soc_mt7628, &gpio_region, bank, en);
+}
+
+// polled interrupts, one thread samples DATA of every watched bank and
+// diffs it against the last sample. The RMASK/FMASK interrupt masks stay
+// off, their status is owned by the kernel's handler of the shared irq
+static mraa_adv_func_t poll_func_table;
+static mraa_boolean_t poll_func_table_ready = 0;
+static pthread_mutex_t poll_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poll_idle = PTHREAD_COND_INITIALIZER;
+static mraa_gpio_context poll_dev[MT7628_GPIO_BANKS * 32];
+static uint32_t poll_rise[MT7628_GPIO_BANKS];
+static uint32_t poll_fall[MT7628_GPIO_BANKS];
+static uint32_t poll_last[MT7628_GPIO_BANKS];
+static int poll_count = 0;
+static int poll_cpu = -1;
+static mraa_boolean_t poll_running = 0;
+static mraa_gpio_context poll_busy = NULL;
+static pthread_t poll_thread;
+
+#define MT7628_REG(reg, bank) (*(volatile uint32_t*) (gpio_region.base + (reg) + (bank) * 4))
+
+// call with poll_lock held
+static void
+mraa_mtk_linkit_poll_affinity()
+{
+    if (poll_running && poll_cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(poll_cpu, &cpus);
+        pthread_setaffinity_np(poll_thread, sizeof(cpus), &cpus);
     }
-    munmap(mmap_reg, mmap_size);
-    mmap_reg = NULL;
-    if (close(mmap_fd) != 0) {
-        return MRAA_ERROR_INVALID_RESOURCE;
+}
+
+static void*
+mraa_mtk_linkit_poll_thread(void* arg)
+{
+    uint32_t edges[MT7628_GPIO_BANKS];
+    unsigned int bank;
+
+    for (;;) {
+        mraa_boolean_t pending = 0;
+
+        pthread_mutex_lock(&poll_lock);
+        if (poll_count == 0) {
+            poll_running = 0;
+            pthread_mutex_unlock(&poll_lock);
+            return NULL;
+        }
+        for (bank = 0; bank < MT7628_GPIO_BANKS; bank++) {
+            uint32_t watched = poll_rise[bank] | poll_fall[bank];
+            edges[bank] = 0;
+            if (watched == 0) {
+                continue;
+            }
+            uint32_t data = MT7628_REG(MT7628_GPIO_DATA, bank);
+            uint32_t changed = (data ^ poll_last[bank]) & watched;
+            edges[bank] = changed & ((data & poll_rise[bank]) | (~data & poll_fall[bank]));
+            poll_last[bank] = data;
+        }
+        pthread_mutex_unlock(&poll_lock);
+
+        for (bank = 0; bank < MT7628_GPIO_BANKS; bank++) {
+            uint32_t stat = edges[bank];
+            if (stat != 0) {
+                pending = 1;
+            }
+            while (stat != 0) {
+                int pin = bank * 32 + __builtin_ctz(stat);
+                stat &= stat - 1;
+
+                pthread_mutex_lock(&poll_lock);
+                mraa_gpio_context dev = poll_dev[pin];
+                poll_busy = dev;
+                pthread_mutex_unlock(&poll_lock);
+                if (dev != NULL) {
+                    mraa_gpio_isr_call(dev);
+                }
+                pthread_mutex_lock(&poll_lock);
+                poll_busy = NULL;
+                pthread_cond_broadcast(&poll_idle);
+                pthread_mutex_unlock(&poll_lock);
+            }
+        }
+        if (!pending) {
+            // the 7628 is single core, don't starve everything else
+            sched_yield();
+        }
     }
+}
+
+static void*
+mraa_mtk_linkit_poll_handler(mraa_gpio_context dev)
+{
+    pthread_mutex_lock(&poll_lock);
+    if (poll_dev[dev->pin] == NULL) {
+        poll_dev[dev->pin] = dev;
+        poll_count++;
+    }
+    if (!poll_running) {
+        if (pthread_create(&poll_thread, NULL, mraa_mtk_linkit_poll_thread, NULL) != 0) {
+            syslog(LOG_ERR, "linkit poll: failed to create thread");
+        } else {
+            pthread_detach(poll_thread);
+            poll_running = 1;
+            mraa_mtk_linkit_poll_affinity();
+        }
+    }
+    pthread_mutex_unlock(&poll_lock);
+
+    // the isr runs on the polling thread, this one only waits to be cancelled
+    for (;;) {
+        pause();
+    }
+    return NULL;
+}
+
+static mraa_result_t
+mraa_mtk_linkit_poll_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
+{
+    unsigned int bank = dev->pin / 32;
+    uint32_t bit = (uint32_t)(1 << (dev->pin % 32));
+
+    if (mode == MRAA_GPIO_EDGE_NONE) {
+        pthread_mutex_lock(&poll_lock);
+        poll_rise[bank] &= ~bit;
+        poll_fall[bank] &= ~bit;
+        if (poll_dev[dev->pin] == dev) {
+            poll_dev[dev->pin] = NULL;
+            poll_count--;
+        }
+        // an isr exiting itself cannot wait for itself
+        while (poll_busy == dev && !pthread_equal(poll_thread, pthread_self())) {
+            pthread_cond_wait(&poll_idle, &poll_lock);
+        }
+        pthread_mutex_unlock(&poll_lock);
+        return MRAA_SUCCESS;
+    }
+
+    mraa_boolean_t rising = mode == MRAA_GPIO_EDGE_BOTH || mode == MRAA_GPIO_EDGE_RISING;
+    mraa_boolean_t falling = mode == MRAA_GPIO_EDGE_BOTH || mode == MRAA_GPIO_EDGE_FALLING;
+    if (!rising && !falling) {
+        return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+
+    pthread_mutex_lock(&poll_lock);
+    // edges are changes from here on, not from whatever was last sampled
+    poll_last[bank] = (poll_last[bank] & ~bit) | (MT7628_REG(MT7628_GPIO_DATA, bank) & bit);
+    poll_rise[bank] = rising ? poll_rise[bank] | bit : poll_rise[bank] & ~bit;
+    poll_fall[bank] = falling ? poll_fall[bank] | bit : poll_fall[bank] & ~bit;
+    pthread_mutex_unlock(&poll_lock);
     return MRAA_SUCCESS;
 }
 
-int
-mraa_mtk_linkit_mmap_read(mraa_gpio_context dev)
+static mraa_result_t
+mraa_mtk_linkit_isr_poll_setup(mraa_gpio_context dev, int cpu)
 {
-    uint32_t value = *(volatile uint32_t*) (mmap_reg + MT7628_GPIO_DATA + (dev->pin / 32) * 4);
-    if (value & (uint32_t)(1 << (dev->pin % 32))) {
-        return 1;
+    if (gpio_region.base == NULL || dev->mmap_read != &mraa_mtk_linkit_mmap_read ||
+        dev->pin < 0 || dev->pin >= MT7628_GPIO_BANKS * 32) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    pthread_mutex_lock(&poll_lock);
+    if (!poll_func_table_ready) {
+        memcpy(&poll_func_table, dev->advance_func, sizeof(mraa_adv_func_t));
+        poll_func_table.gpio_interrupt_handler_replace = &mraa_mtk_linkit_poll_handler;
+        poll_func_table.gpio_edge_mode_replace = &mraa_mtk_linkit_poll_edge_mode;
+        poll_func_table.gpio_isr_poll_setup = NULL;
+        poll_func_table_ready = 1;
     }
-    return 0;
+    // the thread is shared, the last cpu asked for applies to every pin
+    if (cpu >= 0) {
+        poll_cpu = cpu;
+        mraa_mtk_linkit_poll_affinity();
+    }
+    pthread_mutex_unlock(&poll_lock);
+
+    dev->advance_func = &poll_func_table;
+    return MRAA_SUCCESS;
 }
 
 mraa_result_t
@@ -110,11 +353,7 @@ mraa_mtk_linkit_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_mtk_linkit_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(&gpio_region);
     }
 
     if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
@@ -122,48 +361,138 @@ mraa_mtk_linkit_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    // Might need to make some elements of this thread safe.
-    // For example only allow one thread to enter the following block
-    // to prevent mmap'ing twice.
-    if (mmap_reg == NULL) {
-        if ((mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "linkit map: unable to open resource0 file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-
-        mmap_reg = (uint8_t*) mmap(NULL, MT7628_BLOCK_SIZE, PROT_READ | PROT_WRITE,
-                                       MAP_FILE | MAP_SHARED, mmap_fd, 0x10000000);
-        if (mmap_reg == MAP_FAILED) {
-            perror("foo");
-	    syslog(LOG_ERR, "linkit mmap: failed to mmap");
-            mmap_reg = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    if (mraa_mmap_acquire(&gpio_region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "linkit mmap: failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     dev->mmap_write = &mraa_mtk_linkit_mmap_write;
     dev->mmap_read = &mraa_mtk_linkit_mmap_read;
-    mmap_count++;
 
     return MRAA_SUCCESS;
 }
 
-static int mmap_gpiomode(void)
+// period and duty in ns as last programmed, the controller only knows counts
+static struct {
+    int period;
+    int duty;
+    unsigned int clkdiv;
+    uint32_t count;
+} pwm_channel[MT7628_PWM_CHANNELS];
+
+static void
+mraa_mtk_linkit_pwm_program(int ch)
 {
-    if ((gpio_mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-        syslog(LOG_ERR, "linkit map: unable to open resource0 file");
-        return MRAA_ERROR_INVALID_HANDLE;
+    uint64_t count = (uint64_t) pwm_channel[ch].duty * pwm_channel[ch].count;
+    uint32_t thresh = (uint32_t)(count / pwm_channel[ch].period);
+
+    // period/threshold mode clocked from the 40MHz source, as the ramips
+    // driver programs it, low bits the clock divider
+    mraa_mmap_write32(&pwm_region, MT7628_PWM_CON(ch),
+                      MT7628_PWM_CON_OLD_MODE | MT7628_PWM_CON_CLKSEL | pwm_channel[ch].clkdiv);
+    mraa_mmap_write32(&pwm_region, MT7628_PWM_DWIDTH(ch), pwm_channel[ch].count);
+    mraa_mmap_write32(&pwm_region, MT7628_PWM_THRESH(ch), thresh);
+}
+
+static mraa_result_t
+mraa_mtk_linkit_pwm_period_replace(mraa_pwm_context dev, int period)
+{
+    if (dev->pin < 0 || dev->pin >= MT7628_PWM_CHANNELS || period <= 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    gpio_mmap_reg = (uint8_t*) mmap(NULL, MT7628_BLOCK_SIZE, PROT_READ | PROT_WRITE,
-                                   MAP_FILE | MAP_SHARED, gpio_mmap_fd, MT7628_GPIOMODE_BASE);
-    if (gpio_mmap_reg == MAP_FAILED) {
-        syslog(LOG_ERR, "linkit gpio_mmap: failed to mmap");
-        gpio_mmap_reg = NULL;
-        close(gpio_mmap_fd);
-        return MRAA_ERROR_NO_RESOURCES;
+    // smallest divider that fits the period in the counter keeps most resolution
+    unsigned int clkdiv;
+    uint64_t count = 0;
+    for (clkdiv = 0; clkdiv < 8; clkdiv++) {
+        count = ((uint64_t) period * (MT7628_PWM_CLOCK >> clkdiv)) / 1000000000;
+        if (count <= MT7628_PWM_MAX_COUNT) {
+            break;
+        }
+    }
+    if (clkdiv == 8 || count == 0) {
+        syslog(LOG_ERR, "linkit pwm: period %d ns out of range", period);
+        return MRAA_ERROR_INVALID_PARAMETER;
     }
-    return 0;
+
+    // the kernel refuses to enable a channel without a period, and would
+    // reprogram the channel on a change, so tell it first
+    char path[PATH_MAX];
+    char out[MAX_SIZE];
+    if (mraa_sysfs_path(path, sizeof(path), "/sys/class/pwm/pwmchip%d/pwm%d/period", dev->chipid, dev->pin) >= (int) sizeof(path)) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    int length = snprintf(out, sizeof(out), "%d", period);
+    if (mraa_sysfs_attr_write(&dev->period_attr, path, out, length, 1) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "linkit pwm: failed to write period to sysfs");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    int ch = dev->pin;
+    if (pwm_channel[ch].duty > period) {
+        pwm_channel[ch].duty = period;
+    }
+    pwm_channel[ch].period = period;
+    pwm_channel[ch].clkdiv = clkdiv;
+    pwm_channel[ch].count = (uint32_t) count;
+    mraa_mtk_linkit_pwm_program(ch);
+    return MRAA_SUCCESS;
+}
+
+static mraa_result_t
+mraa_mtk_linkit_pwm_duty_replace(mraa_pwm_context dev, int duty)
+{
+    if (dev->pin < 0 || dev->pin >= MT7628_PWM_CHANNELS || duty < 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    int ch = dev->pin;
+    if (pwm_channel[ch].period <= 0) {
+        syslog(LOG_ERR, "linkit pwm: set a period before the duty cycle");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (duty > pwm_channel[ch].period) {
+        duty = pwm_channel[ch].period;
+    }
+    pwm_channel[ch].duty = duty;
+
+    // only the threshold changes, a single store
+    uint64_t count = (uint64_t) duty * pwm_channel[ch].count;
+    mraa_mmap_write32(&pwm_region, MT7628_PWM_THRESH(ch), (uint32_t)(count / pwm_channel[ch].period));
+    return MRAA_SUCCESS;
+}
+
+static int
+mraa_mtk_linkit_pwm_read_period_replace(mraa_pwm_context dev)
+{
+    if (dev->pin < 0 || dev->pin >= MT7628_PWM_CHANNELS) {
+        return -1;
+    }
+    return pwm_channel[dev->pin].period;
+}
+
+static int
+mraa_mtk_linkit_pwm_read_duty_replace(mraa_pwm_context dev)
+{
+    if (dev->pin < 0 || dev->pin >= MT7628_PWM_CHANNELS) {
+        return -1;
+    }
+    return pwm_channel[dev->pin].duty;
+}
+
+static mraa_result_t
+mraa_mtk_linkit_pwm_enable_post(mraa_pwm_context dev, int enable)
+{
+    if (dev->pin < 0 || dev->pin >= MT7628_PWM_CHANNELS) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    // the kernel has enabled the clock, it may also have reprogrammed the
+    // channel from its own idea of period and duty so put ours back
+    int ch = dev->pin;
+    if (enable && pwm_channel[ch].period > 0) {
+        mraa_mtk_linkit_pwm_program(ch);
+    }
+    // every channel shares the enable register
+    mraa_mmap_update32(&pwm_region, MT7628_PWM_ENABLE, 1 << ch, enable ? 1 << ch : 0);
+    return MRAA_SUCCESS;
 }
 
 static void set_gpiomode(unsigned int mask, unsigned int shift, unsigned int val)
@@ -176,11 +505,11 @@ static void set_gpiomode(unsigned int mask, unsigned int shift, unsigned int val
 		offset += 4;
     }
 
-    reg = *(volatile uint32_t*) (gpio_mmap_reg + offset);
+    reg = mraa_mmap_read32(&gpiomode_region, offset);
 
     reg &= ~(mask << shift);
     reg |= (val << shift);
-    *(volatile uint32_t*) (gpio_mmap_reg + offset) = reg;
+    mraa_mmap_write32(&gpiomode_region, offset, reg);
 }
 
 enum {
@@ -303,6 +632,13 @@ mraa_result_t i2c_init_pre(unsigned int bus)
 mraa_result_t
 pwm_init_post(mraa_pwm_context pwm)
 {
+	if (pwm == NULL)
+		return MRAA_ERROR_INVALID_HANDLE;
+	// pin was already exported so no period was set, registers need one
+	if (pwm_region.base != NULL && pwm->pin >= 0 && pwm->pin < MT7628_PWM_CHANNELS &&
+	    pwm_channel[pwm->pin].period <= 0)
+		mraa_pwm_period_us(pwm, plat->pwm_default_period);
+
 	switch(pwm->pin) {
 	case 0:
 		gpiomode_set(MUX_PWM0, "pwm");
@@ -362,7 +698,7 @@ mraa_mtk_linkit()
 {
     int i;
 
-    if (mmap_gpiomode())
+    if (mraa_mmap_acquire(&gpiomode_region) != MRAA_SUCCESS)
 	    return NULL;
 
     mraa_board_t* b = (mraa_board_t*) malloc(sizeof(mraa_board_t));
@@ -401,7 +737,22 @@ mraa_mtk_linkit()
     memset(b->pins, 0, sizeof(mraa_pininfo_t) * b->phy_pin_count);
     memset(gpio_mux_groups, -1, sizeof(gpio_mux_groups));
 
+    mraa_mmap_soc_regions(&mraa_mmap_soc_mt7628, &gpio_region);
     b->adv_func->gpio_mmap_setup = &mraa_mtk_linkit_mmap_setup;
+    b->adv_func->gpio_dir_replace = &mraa_mtk_linkit_gpio_dir_replace;
+    b->adv_func->gpio_isr_poll_setup = &mraa_mtk_linkit_isr_poll_setup;
+
+    // pwm registers are optional, without them pwm stays on sysfs
+    if (mraa_mmap_acquire(&pwm_region) == MRAA_SUCCESS) {
+        b->adv_func->pwm_period_replace = &mraa_mtk_linkit_pwm_period_replace;
+        b->adv_func->pwm_duty_replace = &mraa_mtk_linkit_pwm_duty_replace;
+        b->adv_func->pwm_read_period_replace = &mraa_mtk_linkit_pwm_read_period_replace;
+        b->adv_func->pwm_read_duty_replace = &mraa_mtk_linkit_pwm_read_duty_replace;
+        b->adv_func->pwm_enable_post = &mraa_mtk_linkit_pwm_enable_post;
+    }
+    b->adv_func->gpio_mmap_bank_write = &mraa_mtk_linkit_mmap_bank_write;
+    b->adv_func->gpio_mmap_bank_read = &mraa_mtk_linkit_mmap_bank_read;
+    b->adv_func->gpio_mmap_bank_setup = &mraa_mtk_linkit_mmap_bank_setup;
 
     for (i = 0; i < b->phy_pin_count; i++) {
         snprintf(b->pins[i].name, MRAA_PIN_NAME_SIZE, "GPIO%d", i);
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mraa_internal.h"
+#include "mmap/mmap_region.h"
+
+typedef struct _mmap_mapping {
+    char* path;
+    off_t offset; /**< page aligned start of the mapping in path */
+    size_t size; /**< page aligned length */
+    uint8_t* addr;
+    int fd; /**< -1 for anonymous simulated registers */
+    int simulated;
+    unsigned int refs; /**< regions currently using the mapping */
+    pthread_mutex_t lock; /**< serialises read-modify-write of its registers */
+    struct _mmap_mapping* next;
+} mraa_mmap_mapping_t;
+
+static pthread_mutex_t mapping_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_mmap_mapping_t* mappings = NULL;
+// simulation is read from the environment on first use unless set explicitly
+static int sim_configured = 0;
+static int sim_enabled = 0;
+static char* sim_backing = NULL;
+
+static void
+mraa_mmap_sim_configure()
+{
+    if (sim_configured) {
+        return;
+    }
+    sim_configured = 1;
+    const char* env = getenv("MRAA_MMAP_SIM");
+    if (env == NULL || env[0] == '\0' || strcmp(env, "0") == 0) {
+        return;
+    }
+    sim_enabled = 1;
+    if (strcmp(env, "1") != 0) {
+        sim_backing = strdup(env);
+    }
+    syslog(LOG_NOTICE, "mmap: simulating registers in %s", sim_backing ? sim_backing : "memory");
+}
+
+mraa_result_t
+mraa_mmap_simulate(const char* backing)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    pthread_mutex_lock(&mapping_lock);
+    if (mappings != NULL) {
+        syslog(LOG_ERR, "mmap: can't change register backing while blocks are mapped");
+        ret = MRAA_ERROR_INVALID_RESOURCE;
+        goto simulate_unlock;
+    }
+    free(sim_backing);
+    sim_backing = (backing != NULL && backing[0] != '\0') ? strdup(backing) : NULL;
+    sim_enabled = 1;
+    sim_configured = 1;
+
+simulate_unlock:
+    pthread_mutex_unlock(&mapping_lock);
+    return ret;
+}
+
+/**
+ * Open the file simulating a block, named after the device file and offset
+ * so unrelated blocks don't alias
+ */
+static int
+mraa_mmap_sim_open(const char* path, off_t offset, size_t size)
+{
+    char name[PATH_MAX];
+    int len = snprintf(name, sizeof(name), "%s/", sim_backing);
+    int i;
+    for (i = 0; path[i] != '\0' && len < (int) sizeof(name) - 1; i++) {
+        name[len++] = (path[i] == '/') ? '_' : path[i];
+    }
+    snprintf(name + len, sizeof(name) - len, "@%llx", (unsigned long long) offset);
+
+    int fd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        syslog(LOG_ERR, "mmap: unable to create simulated registers %s", name);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < (off_t) size && ftruncate(fd, size) != 0)) {
+        syslog(LOG_ERR, "mmap: unable to size simulated registers %s", name);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static mraa_mmap_mapping_t*
+mraa_mmap_find(const char* path, off_t offset, size_t size)
+{
+    mraa_mmap_mapping_t* m;
+    for (m = mappings; m != NULL; m = m->next) {
+        if (strcmp(m->path, path) == 0 && offset >= m->offset &&
+            offset + (off_t) size <= m->offset + (off_t) m->size) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static mraa_mmap_mapping_t*
+mraa_mmap_create(const char* path, off_t offset, size_t size)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    mraa_mmap_mapping_t* m = (mraa_mmap_mapping_t*) calloc(1, sizeof(mraa_mmap_mapping_t));
+    if (m == NULL) {
+        return NULL;
+    }
+
+    m->offset = offset & ~((off_t) page - 1);
+    m->size = (size + (offset - m->offset) + page - 1) & ~((size_t) page - 1);
+    m->simulated = sim_enabled;
+    if (!m->simulated) {
+        m->fd = open(path, O_RDWR | O_CLOEXEC);
+        if (m->fd < 0) {
+            syslog(LOG_ERR, "mmap: unable to open %s", path);
+            free(m);
+            return NULL;
+        }
+        m->addr = (uint8_t*) mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, m->offset);
+    } else if (sim_backing != NULL) {
+        // the file stands for the mapped window only, so it is mapped from 0
+        m->fd = mraa_mmap_sim_open(path, m->offset, m->size);
+        if (m->fd < 0) {
+            free(m);
+            return NULL;
+        }
+        m->addr = (uint8_t*) mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+    } else {
+        m->fd = -1;
+        m->addr = (uint8_t*) mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (m->addr == MAP_FAILED) {
+        syslog(LOG_ERR, "mmap: failed to map %s at 0x%llx", path, (unsigned long long) offset);
+        if (m->fd >= 0) {
+            close(m->fd);
+        }
+        free(m);
+        return NULL;
+    }
+    pthread_mutex_init(&m->lock, NULL);
+    m->path = strdup(path);
+    m->next = mappings;
+    mappings = m;
+    return m;
+}
+
+mraa_result_t
+mraa_mmap_acquire(mraa_mmap_region_t* region)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    if (region == NULL || region->path == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&mapping_lock);
+    if (region->refs > 0) {
+        region->refs++;
+        goto acquire_unlock;
+    }
+    mraa_mmap_sim_configure();
+
+    size_t size = region->size;
+    if (size == 0 && sim_enabled) {
+        // there is no device file to size, a page covers the blocks we drive
+        size = sysconf(_SC_PAGESIZE);
+    } else if (size == 0) {
+        struct stat st;
+        if (stat(region->path, &st) != 0 || st.st_size <= region->offset) {
+            syslog(LOG_ERR, "mmap: unable to size %s", region->path);
+            ret = MRAA_ERROR_INVALID_RESOURCE;
+            goto acquire_unlock;
+        }
+        size = st.st_size - region->offset;
+    }
+
+    mraa_mmap_mapping_t* m = mraa_mmap_find(region->path, region->offset, size);
+    if (m == NULL) {
+        m = mraa_mmap_create(region->path, region->offset, size);
+        if (m == NULL) {
+            ret = MRAA_ERROR_NO_RESOURCES;
+            goto acquire_unlock;
+        }
+    }
+    m->refs++;
+    region->mapping = m;
+    region->base = m->addr + (region->offset - m->offset);
+    region->simulated = m->simulated;
+    region->refs = 1;
+
+acquire_unlock:
+    pthread_mutex_unlock(&mapping_lock);
+    return ret;
+}
+
+mraa_result_t
+mraa_mmap_release(mraa_mmap_region_t* region)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    if (region == NULL) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&mapping_lock);
+    if (region->refs == 0) {
+        syslog(LOG_ERR, "mmap: releasing a region that is not mapped");
+        ret = MRAA_ERROR_INVALID_RESOURCE;
+        goto release_unlock;
+    }
+    if (--region->refs > 0) {
+        goto release_unlock;
+    }
+
+    mraa_mmap_mapping_t* m = (mraa_mmap_mapping_t*) region->mapping;
+    region->base = NULL;
+    region->mapping = NULL;
+    region->simulated = 0;
+    if (--m->refs > 0) {
+        goto release_unlock;
+    }
+
+    mraa_mmap_mapping_t** link;
+    for (link = &mappings; *link != NULL; link = &(*link)->next) {
+        if (*link == m) {
+            *link = m->next;
+            break;
+        }
+    }
+    munmap(m->addr, m->size);
+    if (m->fd >= 0 && close(m->fd) != 0) {
+        ret = MRAA_ERROR_INVALID_RESOURCE;
+    }
+    pthread_mutex_destroy(&m->lock);
+    free(m->path);
+    free(m);
+
+release_unlock:
+    pthread_mutex_unlock(&mapping_lock);
+    return ret;
+}
+
+void
+mraa_mmap_update32(const mraa_mmap_region_t* region, uint32_t offset, uint32_t mask, uint32_t value)
+{
+    mraa_mmap_mapping_t* m = (mraa_mmap_mapping_t*) region->mapping;
+
+    pthread_mutex_lock(&m->lock);
+    uint32_t reg = mraa_mmap_read32(region, offset);
+    mraa_mmap_write32(region, offset, (reg & ~mask) | (value & mask));
+    pthread_mutex_unlock(&m->lock);
+}
+
+void
+mraa_mmap_sim_write32(const mraa_mmap_region_t* region, uint32_t offset, uint32_t value)
+{
+    const mraa_mmap_sim_t* model = region->model;
+    uint32_t* reg = (uint32_t*) (region->base + offset);
+    uint32_t bank;
+
+    if (model != NULL && offset >= model->set && offset < model->set + model->banks * 4) {
+        bank = (offset - model->set) / 4;
+        __sync_fetch_and_or((uint32_t*) (region->base + model->data) + bank, value);
+        if (model->input != model->data) {
+            __sync_fetch_and_or((uint32_t*) (region->base + model->input) + bank, value);
+        }
+        *(volatile uint32_t*) reg = value;
+        return;
+    }
+    if (model != NULL && offset >= model->clear && offset < model->clear + model->banks * 4) {
+        bank = (offset - model->clear) / 4;
+        __sync_fetch_and_and((uint32_t*) (region->base + model->data) + bank, ~value);
+        if (model->input != model->data) {
+            __sync_fetch_and_and((uint32_t*) (region->base + model->input) + bank, ~value);
+        }
+        *(volatile uint32_t*) reg = value;
+        return;
+    }
+    *(volatile uint32_t*) reg = value;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "mraa_internal.h"
+#include "mmap/mmap_soc.h"
+
+#define MMAP_PATH "/dev/mem"
+
+// AM335x, one bank per block, OUT holds the driven level and IN the pad
+const mraa_mmap_soc_t mraa_mmap_soc_am335x = {
+    "am335x", { 0x194, 0x190, 0x13c, 0x138, 1 }, 4,
+    { 0x44e07000, 0x4804c000, 0x481ac000, 0x481ae000 }, 4 * 1024
+};
+
+// BCM283x, GPLEV reads back what GPSET/GPCLR drive
+const mraa_mmap_soc_t mraa_mmap_soc_bcm2835 = {
+    "bcm2835", { 0x01c, 0x028, 0x034, 0x034, 2 }, 1, { 0x20200000 }, 4 * 1024
+};
+
+const mraa_mmap_soc_t mraa_mmap_soc_bcm2836 = {
+    "bcm2836", { 0x01c, 0x028, 0x034, 0x034, 2 }, 1, { 0x3f200000 }, 4 * 1024
+};
+
+// MT7628, the gpio registers sit in the system control block
+const mraa_mmap_soc_t mraa_mmap_soc_mt7628 = {
+    "mt7628", { 0x630, 0x640, 0x620, 0x620, 3 }, 1, { 0x10000000 }, 0x1000
+};
+
+static const mraa_mmap_soc_t* socs[] = {
+    &mraa_mmap_soc_am335x,
+    &mraa_mmap_soc_bcm2835,
+    &mraa_mmap_soc_bcm2836,
+    &mraa_mmap_soc_mt7628,
+};
+
+const mraa_mmap_soc_t*
+mraa_mmap_soc_find(const char* name)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(socs) / sizeof(socs[0]); i++) {
+        if (strcmp(socs[i]->name, name) == 0) {
+            return socs[i];
+        }
+    }
+    return NULL;
+}
+
+void
+mraa_mmap_soc_regions(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions)
+{
+    unsigned int i;
+
+    for (i = 0; i < soc->blocks; i++) {
+        mraa_mmap_region_t region = MRAA_MMAP_REGION_SIM(MMAP_PATH, soc->base[i], soc->size, &soc->model);
+        regions[i] = region;
+    }
+}
+
+mraa_mmap_region_t*
+mraa_mmap_soc_block(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin)
+{
+    if (pin < 0 || (unsigned int) pin / 32 >= soc->blocks * soc->model.banks) {
+        return NULL;
+    }
+    return &regions[pin / 32 / soc->model.banks];
+}
+
+mraa_result_t
+mraa_mmap_soc_bank_setup(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, unsigned int bank, mraa_boolean_t en)
+{
+    if (bank >= soc->blocks * soc->model.banks) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    if (en) {
+        return mraa_mmap_acquire(&regions[bank / soc->model.banks]);
+    }
+    return mraa_mmap_release(&regions[bank / soc->model.banks]);
+}
+
+mraa_result_t
+mraa_mmap_soc_gpio_write(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin, int value)
+{
+    unsigned int bank = pin / 32;
+    uint32_t reg = (value ? soc->model.set : soc->model.clear) + (bank % soc->model.banks) * 4;
+
+    mraa_mmap_write32(&regions[bank / soc->model.banks], reg, (uint32_t)(1 << (pin % 32)));
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_mmap_soc_gpio_read(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, int pin)
+{
+    unsigned int bank = pin / 32;
+    uint32_t reg = soc->model.input + (bank % soc->model.banks) * 4;
+
+    if (mraa_mmap_read32(&regions[bank / soc->model.banks], reg) & (uint32_t)(1 << (pin % 32))) {
+        return 1;
+    }
+    return 0;
+}
+
+mraa_result_t
+mraa_mmap_soc_bank_write(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, unsigned int bank, uint32_t mask, uint32_t value)
+{
+    if (bank >= soc->blocks * soc->model.banks || regions[bank / soc->model.banks].base == NULL) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    mraa_mmap_region_t* region = &regions[bank / soc->model.banks];
+    uint32_t off = (bank % soc->model.banks) * 4;
+    // SET then CLEAR, each a single store covering the whole bank
+    mraa_mmap_write32(region, soc->model.set + off, mask & value);
+    mraa_mmap_write32(region, soc->model.clear + off, mask & ~value);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_mmap_soc_bank_read(const mraa_mmap_soc_t* soc, mraa_mmap_region_t* regions, unsigned int bank, uint32_t* value)
+{
+    if (bank >= soc->blocks * soc->model.banks || regions[bank / soc->model.banks].base == NULL) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    *value = mraa_mmap_read32(&regions[bank / soc->model.banks], soc->model.input + (bank % soc->model.banks) * 4);
+    return MRAA_SUCCESS;
+}
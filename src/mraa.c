@@ -38,18 +38,24 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <pthread.h>
 
 #include "mraa_internal.h"
 #include "gpio.h"
 #include "version.h"
+#include "fake/fake_board.h"
 
 #define MAX_PLATFORM_NAME_LENGTH 128
 mraa_board_t* plat = NULL;
 // static mraa_board_t* current_plat = NULL;
 
 static char platform_name[MAX_PLATFORM_NAME_LENGTH];
+// prefix of every sysfs and devfs path, only set by the fake platform
+static char* sysfs_root = NULL;
 mraa_adv_func_t* advance_func;
 
 const char*
@@ -105,18 +111,24 @@ mraa_init()
     memset(advance_func, 0, sizeof(mraa_adv_func_t));
 
     mraa_platform_t platform_type;
+    const char* fake_root = getenv("MRAA_FAKE_ROOT");
+    if (fake_root != NULL && fake_root[0] != '\0') {
+        // A directory tree stands in for sysfs and devfs, skip detection
+        platform_type = mraa_fake_platform(fake_root);
+    } else {
 #if defined(X86PLAT)
-    // Use runtime x86 platform detection
-    platform_type = mraa_x86_platform();
+        // Use runtime x86 platform detection
+        platform_type = mraa_x86_platform();
 #elif defined(ARMPLAT)
-    // Use runtime ARM platform detection
-    platform_type = mraa_arm_platform();
+        // Use runtime ARM platform detection
+        platform_type = mraa_arm_platform();
 #elif MIPSPLAT
-    // Use runtime ARM platform detection
-    platform_type = mraa_mips_platform();
+        // Use runtime ARM platform detection
+        platform_type = mraa_mips_platform();
 #else
 #error mraa_ARCH NOTHING
 #endif
+    }
 
     if (plat != NULL)
         plat->platform_type = platform_type;
@@ -145,6 +157,7 @@ mraa_init()
     }
 #endif
 
+    mraa_mux_pins_init();
     syslog(LOG_NOTICE, "libmraa initialised for platform '%s' of type %d", mraa_get_platform_name(), mraa_get_platform_type());
     return MRAA_SUCCESS;
 }
@@ -152,6 +165,7 @@ mraa_init()
 void
 mraa_deinit()
 {
+    mraa_mux_release_all();
     if (plat != NULL) {
         if (plat->pins != NULL) {
             free(plat->pins);
@@ -166,6 +180,8 @@ mraa_deinit()
         free(plat);
 
     }
+    free(sysfs_root);
+    sysfs_root = NULL;
     closelog();
 }
 
@@ -184,30 +200,254 @@ mraa_set_priority(const unsigned int priority)
     return sched_setscheduler(0, SCHED_RR, &sched_s);
 }
 
-mraa_result_t
-mraa_setup_mux_mapped(mraa_pin_t meta)
+/*
+ * Mux controller: every gpio line used as a mux is opened once and kept open
+ * with the value last applied, so re-muxing a pin only writes the lines that
+ * change. Other contexts opened on the same line are counted in users and
+ * while there are any the cached value is not trusted.
+ */
+typedef struct {
+    int pin;
+    int value; /**< last value applied, -1 if unknown */
+    int users; /**< other contexts open on this line */
+    mraa_gpio_context gpio; /**< mux handle, NULL until used as a mux */
+} mraa_mux_line_t;
+
+// recursive as opening a mux line goes through gpio init and close, which
+// track themselves; set up at first use as musl has no static initialiser
+static pthread_mutex_t mux_lock;
+static pthread_once_t mux_lock_once = PTHREAD_ONCE_INIT;
+static mraa_mux_line_t* mux_lines = NULL;
+static int mux_line_count = 0;
+static int mux_opening = -1;
+// sorted gpio lines named in the board mux tables, fixed once mraa_init() returns
+static int* mux_pins = NULL;
+static int mux_pin_count = 0;
+
+static void
+mraa_mux_lock_init()
 {
-    int mi;
+    pthread_mutexattr_t attr;
 
-    for (mi = 0; mi < meta.mux_total; mi++) {
-        mraa_gpio_context mux_i;
-        mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-        if (mux_i == NULL) {
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void
+mraa_mux_lock()
+{
+    pthread_once(&mux_lock_once, mraa_mux_lock_init);
+    pthread_mutex_lock(&mux_lock);
+}
+
+static mraa_mux_line_t*
+mraa_mux_line(int pin, mraa_boolean_t create)
+{
+    int i;
+    for (i = 0; i < mux_line_count; i++) {
+        if (mux_lines[i].pin == pin) {
+            return &mux_lines[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    mraa_mux_line_t* lines = realloc(mux_lines, (mux_line_count + 1) * sizeof(mraa_mux_line_t));
+    if (lines == NULL) {
+        return NULL;
+    }
+    mux_lines = lines;
+    mux_lines[mux_line_count].pin = pin;
+    mux_lines[mux_line_count].value = -1;
+    mux_lines[mux_line_count].users = 0;
+    mux_lines[mux_line_count].gpio = NULL;
+    return &mux_lines[mux_line_count++];
+}
+
+static int
+mraa_mux_pin_compare(const void* a, const void* b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+static void
+mraa_mux_collect_pin(const mraa_pin_t* meta, int* pins, int* count)
+{
+    unsigned int mi;
+    for (mi = 0; mi < meta->mux_total && mi < 6; mi++) {
+        pins[(*count)++] = (int) meta->mux[mi].pin;
+    }
+}
+
+static void
+mraa_mux_collect(const mraa_board_t* board, int* pins, int* count)
+{
+    unsigned int i;
+    if (board == NULL || board->pins == NULL) {
+        return;
+    }
+    for (i = 0; i < board->phy_pin_count; i++) {
+        mraa_mux_collect_pin(&board->pins[i].gpio, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].pwm, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].aio, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].mmap.gpio, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].i2c, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].spi, pins, count);
+        mraa_mux_collect_pin(&board->pins[i].uart, pins, count);
+    }
+}
+
+void
+mraa_mux_pins_init()
+{
+    unsigned int total = 0;
+    int count = 0;
+    int i, j;
+
+    if (plat == NULL) {
+        return;
+    }
+    // every pin has at most 6 muxes per function and 7 functions
+    total = plat->phy_pin_count * 6 * 7;
+    if (plat->sub_platform != NULL) {
+        total += plat->sub_platform->phy_pin_count * 6 * 7;
+    }
+    if (total == 0) {
+        return;
+    }
+    int* pins = (int*) malloc(total * sizeof(int));
+    if (pins == NULL) {
+        return;
+    }
+    mraa_mux_collect(plat, pins, &count);
+    mraa_mux_collect(plat->sub_platform, pins, &count);
+    if (count == 0) {
+        free(pins);
+        return;
+    }
+
+    qsort(pins, count, sizeof(int), mraa_mux_pin_compare);
+    for (i = 1, j = 0; i < count; i++) {
+        if (pins[i] != pins[j]) {
+            pins[++j] = pins[i];
+        }
+    }
+    mux_pins = pins;
+    mux_pin_count = j + 1;
+}
+
+static mraa_boolean_t
+mraa_mux_is_pin(int pin)
+{
+    return mux_pin_count > 0 &&
+           bsearch(&pin, mux_pins, mux_pin_count, sizeof(int), mraa_mux_pin_compare) != NULL;
+}
+
+void
+mraa_mux_track_open(mraa_gpio_context dev)
+{
+    // other gpios never drive a mux, keep them off the table and the lock
+    if (!mraa_mux_is_pin(dev->pin)) {
+        return;
+    }
+    mraa_mux_lock();
+    if (dev->pin != mux_opening) {
+        mraa_mux_line_t* line = mraa_mux_line(dev->pin, 1);
+        if (line != NULL) {
+            line->users++;
+        }
+    }
+    pthread_mutex_unlock(&mux_lock);
+}
+
+void
+mraa_mux_track_close(mraa_gpio_context dev)
+{
+    if (!mraa_mux_is_pin(dev->pin)) {
+        return;
+    }
+    mraa_mux_lock();
+    mraa_mux_line_t* line = mraa_mux_line(dev->pin, 0);
+    if (line != NULL && line->gpio != dev && line->users > 0) {
+        line->users--;
+        // whatever that context did to the line is now unknown
+        line->value = -1;
+    }
+    pthread_mutex_unlock(&mux_lock);
+}
+
+void
+mraa_mux_release_all()
+{
+    int i;
+    mraa_mux_lock();
+    for (i = 0; i < mux_line_count; i++) {
+        if (mux_lines[i].gpio != NULL) {
+            mraa_gpio_close(mux_lines[i].gpio);
+        }
+    }
+    free(mux_lines);
+    mux_lines = NULL;
+    mux_line_count = 0;
+    free(mux_pins);
+    mux_pins = NULL;
+    mux_pin_count = 0;
+    pthread_mutex_unlock(&mux_lock);
+}
+
+static mraa_result_t
+mraa_mux_apply(int pin, int value)
+{
+    mraa_mux_line_t* line = mraa_mux_line(pin, 1);
+    if (line == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    if (line->gpio == NULL) {
+        mux_opening = pin;
+        mraa_gpio_context gpio = mraa_gpio_init_raw(pin);
+        mux_opening = -1;
+        if (gpio == NULL) {
             return MRAA_ERROR_INVALID_HANDLE;
         }
+        // platform init hooks may have opened other lines and grown the table
+        line = mraa_mux_line(pin, 0);
+        line->gpio = gpio;
         // this function will sometimes fail, however this is not critical as
         // long as the write succeeds - Test case galileo gen2 pin2
-        mraa_gpio_dir(mux_i, MRAA_GPIO_OUT);
-        mraa_gpio_owner(mux_i, 0);
+        mraa_gpio_dir(line->gpio, MRAA_GPIO_OUT);
+        mraa_gpio_owner(line->gpio, 0);
+        line->value = -1;
+    }
+    // a line outside the board tables isn't tracked, so its users are unknown
+    if (line->users == 0 && line->value == value && mraa_mux_is_pin(pin)) {
+        return MRAA_SUCCESS;
+    }
+    if (mraa_gpio_write(line->gpio, value) != MRAA_SUCCESS) {
+        line->value = -1;
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    line->value = value;
+    return MRAA_SUCCESS;
+}
 
-        if (mraa_gpio_write(mux_i, meta.mux[mi].value) != MRAA_SUCCESS) {
-            mraa_gpio_close(mux_i);
-            return MRAA_ERROR_INVALID_RESOURCE;
+mraa_result_t
+mraa_setup_mux_mapped(mraa_pin_t meta)
+{
+    int mi;
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    mraa_mux_lock();
+    for (mi = 0; mi < meta.mux_total; mi++) {
+        ret = mraa_mux_apply(meta.mux[mi].pin, meta.mux[mi].value);
+        if (ret != MRAA_SUCCESS) {
+            break;
         }
-        mraa_gpio_close(mux_i);
     }
+    pthread_mutex_unlock(&mux_lock);
 
-    return MRAA_SUCCESS;
+    return ret;
 }
 
 void
@@ -503,6 +743,127 @@ mraa_get_default_i2c_bus(uint8_t platform_offset)
 }
 
 
+void
+mraa_sysfs_attr_init(mraa_sysfs_attr_t* attr)
+{
+    attr->fd = -1;
+    attr->length = -1;
+}
+
+static mraa_result_t
+mraa_sysfs_attr_open(mraa_sysfs_attr_t* attr, const char* path)
+{
+    if (attr->fd != -1) {
+        return MRAA_SUCCESS;
+    }
+    attr->fd = open(path, O_RDWR);
+    if (attr->fd == -1) {
+        // some attributes such as drive are write only
+        attr->fd = open(path, O_WRONLY);
+    }
+    if (attr->fd == -1) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    attr->length = -1;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_sysfs_attr_write(mraa_sysfs_attr_t* attr, const char* path, const char* value, int length, mraa_boolean_t cache)
+{
+    if (cache && attr->fd != -1 && attr->length == length && memcmp(attr->value, value, length) == 0) {
+        return MRAA_SUCCESS;
+    }
+    if (mraa_sysfs_attr_open(attr, path) != MRAA_SUCCESS) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (mraa_sysfs_pwrite(attr->fd, value, length) != length) {
+        attr->length = -1;
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+    if (length <= MRAA_SYSFS_ATTR_VALUE_MAX) {
+        memcpy(attr->value, value, length);
+        attr->length = length;
+    } else {
+        attr->length = -1;
+    }
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_sysfs_attr_read(mraa_sysfs_attr_t* attr, const char* path, char* buf, int size)
+{
+    if (mraa_sysfs_attr_open(attr, path) != MRAA_SUCCESS) {
+        return -1;
+    }
+    ssize_t rb = pread(attr->fd, buf, size - 1, 0);
+    if (rb < 0) {
+        return -1;
+    }
+    buf[rb] = '\0';
+    return (int) rb;
+}
+
+void
+mraa_sysfs_attr_close(mraa_sysfs_attr_t* attr)
+{
+    if (attr->fd != -1) {
+        close(attr->fd);
+    }
+    mraa_sysfs_attr_init(attr);
+}
+
+mraa_result_t
+mraa_set_sysfs_root(const char* root)
+{
+    char* copy = NULL;
+    if (root != NULL && root[0] != '\0') {
+        copy = strdup(root);
+        if (copy == NULL) {
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+    }
+    free(sysfs_root);
+    sysfs_root = copy;
+    return MRAA_SUCCESS;
+}
+
+ssize_t
+mraa_sysfs_pwrite(int fd, const char* value, size_t length)
+{
+    ssize_t ret = pwrite(fd, value, length, 0);
+    if (sysfs_root == NULL || ret < 0) {
+        return ret;
+    }
+    // a plain file keeps the tail of a longer previous value, sysfs doesn't,
+    // and reading an attribute back ends in a newline
+    if (pwrite(fd, "\n", 1, ret) != 1 || ftruncate(fd, ret + 1) != 0) {
+        return -1;
+    }
+    return ret;
+}
+
+int
+mraa_sysfs_path(char* buf, size_t len, const char* fmt, ...)
+{
+    int root_len = 0;
+    if (sysfs_root != NULL) {
+        root_len = snprintf(buf, len, "%s", sysfs_root);
+        if (root_len < 0 || (size_t) root_len >= len) {
+            return root_len;
+        }
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int path_len = vsnprintf(buf + root_len, len - root_len, fmt, args);
+    va_end(args);
+    if (path_len < 0) {
+        return path_len;
+    }
+    return root_len + path_len;
+}
+
 mraa_boolean_t
 mraa_file_exist(const char* filename)
 {
@@ -61,4 +61,6 @@
 
 %include "uart.hpp"
 
+#ifndef MRAA_NO_LCD
 %include "lcd.hpp"
+#endif
@@ -30,15 +30,16 @@
 
 #include "pwm.h"
 #include "mraa_internal.h"
+#include "pwm/pwm_soft.h"
 
-#define MAX_SIZE 64
+#define MAX_SIZE 128
 #define SYSFS_PWM "/sys/class/pwm"
 
 static int
 mraa_pwm_setup_duty_fp(mraa_pwm_context dev)
 {
     char bu[MAX_SIZE];
-    snprintf(bu, MAX_SIZE, "/sys/class/pwm/pwmchip%d/pwm%d/duty_cycle", dev->chipid, dev->pin);
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d/duty_cycle", dev->chipid, dev->pin);
 
     dev->duty_fp = open(bu, O_RDWR);
     if (dev->duty_fp == -1) {
@@ -50,6 +51,10 @@ mraa_pwm_setup_duty_fp(mraa_pwm_context dev)
 static mraa_result_t
 mraa_pwm_write_period(mraa_pwm_context dev, int period)
 {
+    if (dev->soft != NULL) {
+        dev->period = period;
+        return mraa_pwm_soft_period(dev, period);
+    }
     if (IS_FUNC_DEFINED(dev, pwm_period_replace)) {
         mraa_result_t result = dev->advance_func->pwm_period_replace(dev, period);
         if (result == MRAA_SUCCESS) {
@@ -58,21 +63,17 @@ mraa_pwm_write_period(mraa_pwm_context dev, int period)
         return result;
     }
     char bu[MAX_SIZE];
-    snprintf(bu, MAX_SIZE, "/sys/class/pwm/pwmchip%d/pwm%d/period", dev->chipid, dev->pin);
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d/period", dev->chipid, dev->pin);
 
-    int period_f = open(bu, O_RDWR);
-    if (period_f == -1) {
-        syslog(LOG_ERR, "pwm: Failed to open period for writing");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
     char out[MAX_SIZE];
     int length = snprintf(out, MAX_SIZE, "%d", period);
-    if (write(period_f, out, length * sizeof(char)) == -1) {
-        close(period_f);
+    if (mraa_sysfs_attr_write(&dev->period_attr, bu, out, length, 1) != MRAA_SUCCESS) {
+        if (dev->period_attr.fd == -1) {
+            syslog(LOG_ERR, "pwm: Failed to open period for writing");
+        }
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    close(period_f);
     dev->period = period;
     return MRAA_SUCCESS;
 }
@@ -80,6 +81,12 @@ mraa_pwm_write_period(mraa_pwm_context dev, int period)
 static mraa_result_t
 mraa_pwm_write_duty(mraa_pwm_context dev, int duty)
 {
+    if (dev->soft != NULL) {
+        return mraa_pwm_soft_duty(dev, duty);
+    }
+    if (IS_FUNC_DEFINED(dev, pwm_duty_replace)) {
+        return dev->advance_func->pwm_duty_replace(dev, duty);
+    }
     if (dev->duty_fp == -1) {
         if (mraa_pwm_setup_duty_fp(dev) == 1) {
             return MRAA_ERROR_INVALID_HANDLE;
@@ -87,7 +94,7 @@ mraa_pwm_write_duty(mraa_pwm_context dev, int duty)
     }
     char bu[64];
     int length = sprintf(bu, "%d", duty);
-    if (write(dev->duty_fp, bu, length * sizeof(char)) == -1)
+    if (mraa_sysfs_pwrite(dev->duty_fp, bu, length * sizeof(char)) == -1)
         return MRAA_ERROR_INVALID_RESOURCE;
     return MRAA_SUCCESS;
 }
@@ -95,22 +102,25 @@ mraa_pwm_write_duty(mraa_pwm_context dev, int duty)
 static int
 mraa_pwm_read_period(mraa_pwm_context dev)
 {
+    if (dev->soft != NULL) {
+        return dev->period;
+    }
+    if (IS_FUNC_DEFINED(dev, pwm_read_period_replace)) {
+        int period = dev->advance_func->pwm_read_period_replace(dev);
+        if (period > 0) {
+            dev->period = period;
+        }
+        return period;
+    }
     char bu[MAX_SIZE];
     char output[MAX_SIZE];
-    snprintf(bu, MAX_SIZE, "/sys/class/pwm/pwmchip%d/pwm%d/period", dev->chipid, dev->pin);
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d/period", dev->chipid, dev->pin);
 
-    int period_f = open(bu, O_RDWR);
-    if (period_f == -1) {
-        syslog(LOG_ERR, "pwm: Failed to open period for reading");
-        return 0;
-    }
-    off_t size = lseek(period_f, 0, SEEK_END);
-    lseek(period_f, 0, SEEK_SET);
-
-    ssize_t rb = read(period_f, output, size + 1);
-    close(period_f);
-
-    if (rb < 0) {
+    if (mraa_sysfs_attr_read(&dev->period_attr, bu, output, MAX_SIZE) < 0) {
+        if (dev->period_attr.fd == -1) {
+            syslog(LOG_ERR, "pwm: Failed to open period for reading");
+            return 0;
+        }
         syslog(LOG_ERR, "pwm: Error in reading period");
         return -1;
     }
@@ -131,21 +141,24 @@ mraa_pwm_read_period(mraa_pwm_context dev)
 static int
 mraa_pwm_read_duty(mraa_pwm_context dev)
 {
+    if (dev->soft != NULL) {
+        return mraa_pwm_soft_read_duty(dev);
+    }
+    if (IS_FUNC_DEFINED(dev, pwm_read_duty_replace)) {
+        return dev->advance_func->pwm_read_duty_replace(dev);
+    }
     if (dev->duty_fp == -1) {
         if (mraa_pwm_setup_duty_fp(dev) == 1) {
             return MRAA_ERROR_INVALID_HANDLE;
         }
-    } else {
-        lseek(dev->duty_fp, 0, SEEK_SET);
     }
-    off_t size = lseek(dev->duty_fp, 0, SEEK_END);
-    lseek(dev->duty_fp, 0, SEEK_SET);
     char output[MAX_SIZE];
-    ssize_t rb = read(dev->duty_fp, output, size + 1);
+    ssize_t rb = pread(dev->duty_fp, output, MAX_SIZE - 1, 0);
     if (rb < 0) {
         syslog(LOG_ERR, "pwm: Error in reading duty");
         return -1;
     }
+    output[rb] = '\0';
 
     char* endptr;
     long int ret = strtol(output, &endptr, 10);
@@ -170,6 +183,9 @@ mraa_pwm_init_internal(mraa_adv_func_t* func_table, int chipin, int pin)
     dev->chipid = chipin;
     dev->pin = pin;
     dev->period = -1;
+    dev->soft = NULL;
+    mraa_sysfs_attr_init(&dev->period_attr);
+    mraa_sysfs_attr_init(&dev->enable_attr);
     dev->advance_func = func_table;
 
     return dev;
@@ -187,6 +203,10 @@ mraa_pwm_init(int pin)
         return NULL;
     }
     if (plat->pins[pin].capabilites.pwm != 1) {
+        if (plat->pins[pin].capabilites.gpio == 1) {
+            syslog(LOG_NOTICE, "pwm: pin %d not capable of pwm, using software pwm", pin);
+            return mraa_pwm_init_soft(pin);
+        }
         syslog(LOG_ERR, "pwm: pin not capable of pwm");
         return NULL;
     }
@@ -243,6 +263,44 @@ mraa_pwm_init(int pin)
     return mraa_pwm_init_raw(chip, pinn);
 }
 
+mraa_pwm_context
+mraa_pwm_init_soft(int pin)
+{
+    if (plat == NULL) {
+        syslog(LOG_ERR, "pwm: Platform Not Initialised");
+        return NULL;
+    }
+
+    mraa_gpio_context gpio = mraa_gpio_init(pin);
+    if (gpio == NULL) {
+        syslog(LOG_ERR, "pwm: failed to initialise gpio %d for software pwm", pin);
+        return NULL;
+    }
+    if (mraa_gpio_dir(gpio, MRAA_GPIO_OUT_LOW) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "pwm: failed to set gpio %d as output", pin);
+        mraa_gpio_close(gpio);
+        return NULL;
+    }
+
+    mraa_pwm_context dev = mraa_pwm_init_internal(plat->adv_func, -1, pin);
+    if (dev == NULL) {
+        mraa_gpio_close(gpio);
+        return NULL;
+    }
+    dev->owner = 1;
+    dev->period = plat->pwm_default_period * 1000;
+    if (plat->pwm_default_period < MRAA_PWM_SOFT_MIN_PERIOD_US ||
+        plat->pwm_default_period > MRAA_PWM_SOFT_MAX_PERIOD_US) {
+        dev->period = 20000000;
+    }
+    if (mraa_pwm_soft_attach(dev, gpio) != MRAA_SUCCESS) {
+        mraa_gpio_close(gpio);
+        free(dev);
+        return NULL;
+    }
+    return dev;
+}
+
 mraa_pwm_context
 mraa_pwm_init_raw(int chipin, int pin)
 {
@@ -251,14 +309,14 @@ mraa_pwm_init_raw(int chipin, int pin)
         return NULL;
 
     char directory[MAX_SIZE];
-    snprintf(directory, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d", dev->chipid, dev->pin);
+    mraa_sysfs_path(directory, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d", dev->chipid, dev->pin);
     struct stat dir;
     if (stat(directory, &dir) == 0 && S_ISDIR(dir.st_mode)) {
         syslog(LOG_NOTICE, "pwm: Pin already exported, continuing");
         dev->owner = 0; // Not Owner
     } else {
         char buffer[MAX_SIZE];
-        snprintf(buffer, MAX_SIZE, "/sys/class/pwm/pwmchip%d/export", dev->chipid);
+        mraa_sysfs_path(buffer, MAX_SIZE, SYSFS_PWM "/pwmchip%d/export", dev->chipid);
         int export_f = open(buffer, O_WRONLY);
         if (export_f == -1) {
             syslog(LOG_ERR, "pwm: Failed to open export for writing");
@@ -322,6 +380,13 @@ mraa_pwm_period_ms(mraa_pwm_context dev, int ms)
 mraa_result_t
 mraa_pwm_period_us(mraa_pwm_context dev, int us)
 {
+    if (dev->soft != NULL) {
+        if (us < MRAA_PWM_SOFT_MIN_PERIOD_US || us > MRAA_PWM_SOFT_MAX_PERIOD_US) {
+            syslog(LOG_ERR, "pwm: period value outside software pwm range");
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+        return mraa_pwm_write_period(dev, us * 1000);
+    }
     if (us < plat->pwm_min_period || us > plat->pwm_max_period) {
         syslog(LOG_ERR, "pwm: period value outside platform range");
         return MRAA_ERROR_INVALID_PARAMETER;
@@ -356,31 +421,37 @@ mraa_pwm_enable(mraa_pwm_context dev, int enable)
     } else {
         status = enable;
     }
+    if (dev->soft != NULL) {
+        return mraa_pwm_soft_enable(dev, status);
+    }
     char bu[MAX_SIZE];
-    snprintf(bu, MAX_SIZE, "/sys/class/pwm/pwmchip%d/pwm%d/enable", dev->chipid, dev->pin);
+    mraa_sysfs_path(bu, MAX_SIZE, SYSFS_PWM "/pwmchip%d/pwm%d/enable", dev->chipid, dev->pin);
 
-    int enable_f = open(bu, O_RDWR);
-
-    if (enable_f == -1) {
-        syslog(LOG_ERR, "pwm: Failed to open enable for writing");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
     char out[2];
     int size = snprintf(out, sizeof(out), "%d", enable);
-    if (write(enable_f, out, size * sizeof(char)) == -1) {
-        syslog(LOG_ERR, "pwm: Failed to write to enable");
-        close(enable_f);
+    if (mraa_sysfs_attr_write(&dev->enable_attr, bu, out, size, 1) != MRAA_SUCCESS) {
+        if (dev->enable_attr.fd == -1) {
+            syslog(LOG_ERR, "pwm: Failed to open enable for writing");
+        } else {
+            syslog(LOG_ERR, "pwm: Failed to write to enable");
+        }
         return MRAA_ERROR_INVALID_RESOURCE;
     }
-    close(enable_f);
+    if (IS_FUNC_DEFINED(dev, pwm_enable_post)) {
+        return dev->advance_func->pwm_enable_post(dev, status);
+    }
     return MRAA_SUCCESS;
 }
 
 mraa_result_t
 mraa_pwm_unexport_force(mraa_pwm_context dev)
 {
+    if (dev->soft != NULL) {
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
     char filepath[MAX_SIZE];
-    snprintf(filepath, MAX_SIZE, "/sys/class/pwm/pwmchip%d/unexport", dev->chipid);
+    mraa_sysfs_path(filepath, MAX_SIZE, SYSFS_PWM "/pwmchip%d/unexport", dev->chipid);
 
     int unexport_f = open(filepath, O_WRONLY);
     if (unexport_f == -1) {
@@ -404,6 +475,17 @@ mraa_result_t
 mraa_pwm_unexport(mraa_pwm_context dev)
 {
     mraa_pwm_enable(dev, 0);
+    // software pwm drives a gpio, there is no pwmchip to unexport from
+    if (dev->soft != NULL) {
+        return MRAA_SUCCESS;
+    }
+    // the attribute files go away with the export
+    mraa_sysfs_attr_close(&dev->period_attr);
+    mraa_sysfs_attr_close(&dev->enable_attr);
+    if (dev->duty_fp != -1) {
+        close(dev->duty_fp);
+        dev->duty_fp = -1;
+    }
     if (dev->owner) {
         return mraa_pwm_unexport_force(dev);
     }
@@ -413,6 +495,11 @@ mraa_pwm_unexport(mraa_pwm_context dev)
 mraa_result_t
 mraa_pwm_close(mraa_pwm_context dev)
 {
+    if (dev->soft != NULL) {
+        mraa_pwm_soft_detach(dev);
+        free(dev);
+        return MRAA_SUCCESS;
+    }
     mraa_pwm_unexport(dev);
     free(dev);
     return MRAA_SUCCESS;
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "pwm.h"
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "pwm/pwm_soft.h"
+
+// serialises attach and detach so the thread is never started whilst stopping
+static pthread_mutex_t soft_control_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t soft_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t soft_wake;
+static pthread_t soft_thread;
+static mraa_boolean_t soft_running = 0;
+static mraa_boolean_t soft_stop = 0;
+static int soft_channels = 0;
+// enabled channels, sorted by next event
+static struct _pwm_soft* queue[MRAA_PWM_SOFT_MAX_CHANNELS];
+static int queue_len = 0;
+
+static uint64_t
+mraa_pwm_soft_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void
+mraa_pwm_soft_sort()
+{
+    int i, j;
+    for (i = 1; i < queue_len; i++) {
+        struct _pwm_soft* c = queue[i];
+        for (j = i; j > 0 && queue[j - 1]->next > c->next; j--) {
+            queue[j] = queue[j - 1];
+        }
+        queue[j] = c;
+    }
+}
+
+static void
+mraa_pwm_soft_set(struct _pwm_soft* c, int level)
+{
+    if (c->level != level) {
+        mraa_gpio_write(c->gpio, level);
+        c->level = level;
+    }
+}
+
+static void
+mraa_pwm_soft_event(struct _pwm_soft* c, uint64_t now)
+{
+    uint64_t late = now - c->next;
+
+    c->edges++;
+    c->jitter_total += late;
+    if (late > c->jitter_max) {
+        c->jitter_max = late > UINT32_MAX ? UINT32_MAX : (uint32_t) late;
+    }
+
+    if (!c->rising) {
+        mraa_pwm_soft_set(c, 0);
+        c->rising = 1;
+        c->next = c->period_start + c->cur_period;
+        return;
+    }
+
+    // stay in phase unless we fell a whole period behind
+    c->period_start = c->next;
+    if (now - c->period_start >= (uint64_t) c->cur_period) {
+        c->period_start = now;
+    }
+    c->cur_period = c->period;
+    c->cur_duty = c->duty;
+
+    if (c->cur_duty <= 0) {
+        mraa_pwm_soft_set(c, 0);
+        c->next = c->period_start + c->cur_period;
+    } else if (c->cur_duty >= c->cur_period) {
+        mraa_pwm_soft_set(c, 1);
+        c->next = c->period_start + c->cur_period;
+    } else {
+        mraa_pwm_soft_set(c, 1);
+        c->rising = 0;
+        c->next = c->period_start + c->cur_duty;
+    }
+}
+
+static void*
+mraa_pwm_soft_thread(void* arg)
+{
+    pthread_mutex_lock(&soft_lock);
+    while (!soft_stop) {
+        if (queue_len == 0) {
+            pthread_cond_wait(&soft_wake, &soft_lock);
+            continue;
+        }
+
+        uint64_t now = mraa_pwm_soft_now();
+        if (queue[0]->next > now) {
+            struct timespec deadline;
+            deadline.tv_sec = queue[0]->next / 1000000000ULL;
+            deadline.tv_nsec = queue[0]->next % 1000000000ULL;
+            pthread_cond_timedwait(&soft_wake, &soft_lock, &deadline);
+            continue;
+        }
+
+        int i;
+        for (i = 0; i < queue_len && queue[i]->next <= now; i++) {
+            mraa_pwm_soft_event(queue[i], now);
+        }
+        mraa_pwm_soft_sort();
+    }
+    pthread_mutex_unlock(&soft_lock);
+    return NULL;
+}
+
+static mraa_result_t
+mraa_pwm_soft_start()
+{
+    pthread_condattr_t cond_attr;
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&soft_wake, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    soft_stop = 0;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    if (pthread_create(&soft_thread, &attr, mraa_pwm_soft_thread, NULL) != 0) {
+        // not allowed to go realtime, run with normal scheduling
+        syslog(LOG_NOTICE, "pwm soft: could not create SCHED_FIFO thread, jitter will be higher");
+        if (pthread_create(&soft_thread, NULL, mraa_pwm_soft_thread, NULL) != 0) {
+            pthread_attr_destroy(&attr);
+            pthread_cond_destroy(&soft_wake);
+            syslog(LOG_ERR, "pwm soft: failed to create thread");
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    soft_running = 1;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_pwm_soft_attach(mraa_pwm_context dev, mraa_gpio_context gpio)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    struct _pwm_soft* c = (struct _pwm_soft*) calloc(1, sizeof(struct _pwm_soft));
+    if (c == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    c->gpio = gpio;
+    c->period = dev->period;
+    c->level = -1;
+
+    pthread_mutex_lock(&soft_control_lock);
+    pthread_mutex_lock(&soft_lock);
+    if (soft_channels == MRAA_PWM_SOFT_MAX_CHANNELS) {
+        syslog(LOG_ERR, "pwm soft: all %d channels in use", MRAA_PWM_SOFT_MAX_CHANNELS);
+        ret = MRAA_ERROR_NO_RESOURCES;
+    } else if (!soft_running) {
+        ret = mraa_pwm_soft_start();
+    }
+    if (ret == MRAA_SUCCESS) {
+        soft_channels++;
+        mraa_pwm_soft_set(c, 0);
+        dev->soft = c;
+    } else {
+        free(c);
+    }
+    pthread_mutex_unlock(&soft_lock);
+    pthread_mutex_unlock(&soft_control_lock);
+    return ret;
+}
+
+mraa_result_t
+mraa_pwm_soft_period(mraa_pwm_context dev, int period)
+{
+    pthread_mutex_lock(&soft_lock);
+    dev->soft->period = period;
+    pthread_mutex_unlock(&soft_lock);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_pwm_soft_duty(mraa_pwm_context dev, int duty)
+{
+    if (duty < 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    pthread_mutex_lock(&soft_lock);
+    dev->soft->duty = duty;
+    pthread_mutex_unlock(&soft_lock);
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_pwm_soft_read_duty(mraa_pwm_context dev)
+{
+    pthread_mutex_lock(&soft_lock);
+    int duty = dev->soft->duty;
+    pthread_mutex_unlock(&soft_lock);
+    return duty;
+}
+
+static void
+mraa_pwm_soft_dequeue(struct _pwm_soft* c)
+{
+    int i;
+    for (i = 0; i < queue_len; i++) {
+        if (queue[i] == c) {
+            memmove(&queue[i], &queue[i + 1], (queue_len - i - 1) * sizeof(queue[0]));
+            queue_len--;
+            break;
+        }
+    }
+    c->enabled = 0;
+    mraa_pwm_soft_set(c, 0);
+}
+
+mraa_result_t
+mraa_pwm_soft_enable(mraa_pwm_context dev, int enable)
+{
+    struct _pwm_soft* c = dev->soft;
+
+    pthread_mutex_lock(&soft_lock);
+    if (enable && !c->enabled) {
+        c->enabled = 1;
+        c->rising = 1;
+        c->next = mraa_pwm_soft_now();
+        c->period_start = c->next;
+        c->edges = 0;
+        c->jitter_total = 0;
+        c->jitter_max = 0;
+        queue[queue_len++] = c;
+        mraa_pwm_soft_sort();
+        pthread_cond_signal(&soft_wake);
+    } else if (!enable && c->enabled) {
+        mraa_pwm_soft_dequeue(c);
+    }
+    pthread_mutex_unlock(&soft_lock);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_pwm_soft_detach(mraa_pwm_context dev)
+{
+    struct _pwm_soft* c = dev->soft;
+    mraa_boolean_t join = 0;
+
+    pthread_mutex_lock(&soft_control_lock);
+    pthread_mutex_lock(&soft_lock);
+    if (c->enabled) {
+        mraa_pwm_soft_dequeue(c);
+    }
+    soft_channels--;
+    if (soft_channels == 0) {
+        soft_stop = 1;
+        pthread_cond_signal(&soft_wake);
+        join = 1;
+    }
+    pthread_mutex_unlock(&soft_lock);
+
+    if (join) {
+        pthread_join(soft_thread, NULL);
+        pthread_cond_destroy(&soft_wake);
+        soft_running = 0;
+    }
+    pthread_mutex_unlock(&soft_control_lock);
+    mraa_gpio_close(c->gpio);
+    free(c);
+    dev->soft = NULL;
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_pwm_jitter(mraa_pwm_context dev, mraa_pwm_jitter_t* stats)
+{
+    if (dev == NULL || stats == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+    if (dev->soft == NULL) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    pthread_mutex_lock(&soft_lock);
+    stats->edges = dev->soft->edges;
+    stats->mean_jitter_ns = dev->soft->edges ? (unsigned int) (dev->soft->jitter_total / dev->soft->edges) : 0;
+    stats->max_jitter_ns = dev->soft->jitter_max;
+    pthread_mutex_unlock(&soft_lock);
+    return MRAA_SUCCESS;
+}
@@ -34,7 +34,7 @@
 #include "spi.h"
 #include "mraa_internal.h"
 
-#define MAX_SIZE 64
+#define MAX_SIZE 128
 #define SPI_MAX_LENGTH 4096
 
 static mraa_spi_context
@@ -131,7 +131,7 @@ mraa_spi_init_raw(unsigned int bus, unsigned int cs)
     }
 
     char path[MAX_SIZE];
-    sprintf(path, "/dev/spidev%u.%u", bus, cs);
+    mraa_sysfs_path(path, MAX_SIZE, "/dev/spidev%u.%u", bus, cs);
 
     dev->devfd = open(path, O_RDWR);
     if (dev->devfd < 0) {
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
 #include "linux/i2c-dev.h"
 #include "common.h"
 #include "ftd2xx.h"
@@ -35,6 +36,12 @@
 #define PLATFORM_NAME "FTDI FT4222"
 #define I2CM_ERROR(status) (((status) &0x02) != 0)
 #define PCA9672_ADDR 0x20
+// longest wait for an expander interrupt before its pins are read anyway, in
+// case a USB notification was missed
+#define ISR_BACKSTOP_MS 1000
+// the bridge notifies received data on the same handle, so a notification
+// during or just after a handler's own expander read is taken to be that read
+#define ISR_SETTLE_MS 5
 
 
 static FT_HANDLE ftHandle = (FT_HANDLE) NULL;
@@ -42,6 +49,17 @@ static int bus_speed = 400;
 static int numI2cGpioExapnderPins = 8;
 static int numUsbGpio = 0;
 
+// the PCA9672 /INT output is expected on GPIO3, the FT4222 pin that can
+// raise a USB interrupt
+static pthread_mutex_t isr_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t isr_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int isr_generation = 0;
+static int isr_state = 0; // 0 not set up, 1 interrupt driven, -1 polled
+static int isr_reading = 0;
+static struct timespec isr_read_end;
+static pthread_t isr_thread;
+static EVENT_HANDLE isr_event;
+
 
 mraa_result_t
 mraa_ftdi_ft4222_init()
@@ -203,6 +221,65 @@ mraa_ftdi_ft4222_detect_io_expander()
 
 
 /******************* I2C functions *******************/
+/**
+ * Run a chain of messages with a repeated start between them and a single
+ * stop at the end. The controller status is checked once for the whole chain
+ * rather than after every message, which saves a USB round trip per message.
+ */
+static mraa_result_t
+mraa_ftdi_ft4222_i2c_transfer(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int count)
+{
+    FT4222_STATUS ft4222Status;
+    uint16 bytesTransferred = 0;
+    uint8 controllerStatus;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        uint8 flag = (i == 0) ? START : Repeated_START;
+        if (i == count - 1)
+            flag |= STOP;
+        if (msgs[i].flags & MRAA_I2C_MSG_READ)
+            ft4222Status = FT4222_I2CMaster_ReadEx(dev->handle, msgs[i].addr, flag, msgs[i].buf,
+                                                   msgs[i].len, &bytesTransferred);
+        else
+            ft4222Status = FT4222_I2CMaster_WriteEx(dev->handle, msgs[i].addr, flag, msgs[i].buf,
+                                                    msgs[i].len, &bytesTransferred);
+        if (FT4222_OK != ft4222Status || bytesTransferred != msgs[i].len) {
+            syslog(LOG_ERR, "FT4222_I2CMaster transfer to %#02X failed (error %d, %u of %u bytes)\n",
+                   msgs[i].addr, (int) ft4222Status, bytesTransferred, msgs[i].len);
+            // the chain may have stopped short of its stop condition
+            FT4222_I2CMaster_Reset(dev->handle);
+            return MRAA_ERROR_UNSPECIFIED;
+        }
+    }
+
+    ft4222Status = FT4222_I2CMaster_GetStatus(dev->handle, &controllerStatus);
+    if (FT4222_OK != ft4222Status || I2CM_ERROR(controllerStatus)) {
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+    return MRAA_SUCCESS;
+}
+
+/**
+ * Write the register then read it back without releasing the bus
+ */
+static int
+mraa_ftdi_ft4222_i2c_read_reg(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
+{
+    mraa_i2c_msg_t msgs[2];
+
+    msgs[0].addr = dev->addr;
+    msgs[0].flags = MRAA_I2C_MSG_WRITE;
+    msgs[0].len = 1;
+    msgs[0].buf = &command;
+    msgs[1].addr = dev->addr;
+    msgs[1].flags = MRAA_I2C_MSG_READ;
+    msgs[1].len = length;
+    msgs[1].buf = data;
+    return mraa_ftdi_ft4222_i2c_transfer(dev, msgs, 2) == MRAA_SUCCESS ? length : -1;
+}
+
+
 static mraa_i2c_context
 mraa_ftdi_ft4222_i2c_init_raw(unsigned int bus)
 {
@@ -293,20 +370,27 @@ mraa_ftdi_ft4222_i2c_read(mraa_i2c_context dev, uint8_t* data, int length)
 static uint8_t
 mraa_ftdi_ft4222_i2c_read_byte(mraa_i2c_context dev)
 {
-    return 0;
+    uint8_t data;
+    if (mraa_ftdi_ft4222_i2c_read(dev, &data, 1) != 1)
+        return 0;
+    return data;
 }
 
 
 static uint16_t
 mraa_ftdi_ft4222_i2c_read_word_data(mraa_i2c_context dev, uint8_t command)
 {
-    return 0;
+    uint8_t data[2];
+    // smbus words are little endian
+    if (mraa_ftdi_ft4222_i2c_read_reg(dev, command, data, 2) != 2)
+        return 0;
+    return data[0] | (data[1] << 8);
 }
 
 static int
 mraa_ftdi_ft4222_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
 {
-    return -1;
+    return mraa_ftdi_ft4222_i2c_read_reg(dev, command, data, length);
 }
 
 
@@ -328,11 +412,8 @@ mraa_ftdi_ft4222_i2c_write_byte(mraa_i2c_context dev, uint8_t data)
 static uint8_t
 mraa_ftdi_ft4222_i2c_read_byte_data(mraa_i2c_context dev, uint8_t command)
 {
-    const uint8_t reg_addr = command;
     uint8_t data;
-    if (mraa_ftdi_ft4222_i2c_write(dev, &reg_addr, 1) != MRAA_SUCCESS)
-        return 0;
-    if (mraa_ftdi_ft4222_i2c_read(dev, &data, 1) != 1)
+    if (mraa_ftdi_ft4222_i2c_read_reg(dev, command, &data, 1) != 1)
         return 0;
     return data;
 }
@@ -365,7 +446,7 @@ mraa_ftdi_ft4222_i2c_stop(mraa_i2c_context dev)
 /******************* GPIO functions *******************/
 
 static mraa_result_t
-mraa_ftdi_ft4222_gpio_init_internal_replace(int pin)
+mraa_ftdi_ft4222_gpio_init_internal_replace(mraa_gpio_context dev, int pin)
 {
     return MRAA_SUCCESS;
 }
@@ -440,18 +521,131 @@ mraa_ftdi_ft4222_sleep_ms(unsigned long mseconds)
         ;
 }
 
+/**
+ * Read the expander from a handler thread, marking the read so that the
+ * notification it causes does not wake the handlers again
+ */
+static int
+mraa_ftdi_ft4222_isr_read(mraa_gpio_context dev)
+{
+    pthread_mutex_lock(&isr_lock);
+    isr_reading++;
+    pthread_mutex_unlock(&isr_lock);
+    int level = mraa_ftdi_ft4222_gpio_read_replace(dev);
+    pthread_mutex_lock(&isr_lock);
+    isr_reading--;
+    clock_gettime(CLOCK_MONOTONIC, &isr_read_end);
+    pthread_mutex_unlock(&isr_lock);
+    return level;
+}
+
+/**
+ * Turn USB notifications that are not the handlers' own reads into a new
+ * generation for the handler threads, whichever of them the driver would
+ * have woken
+ */
+static void*
+mraa_ftdi_ft4222_isr_monitor(void* arg)
+{
+    struct timespec deadline;
+    struct timespec now;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&isr_event.eMutex);
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ISR_BACKSTOP_MS / 1000;
+        ret = pthread_cond_timedwait(&isr_event.eCondVar, &isr_event.eMutex, &deadline);
+        pthread_mutex_unlock(&isr_event.eMutex);
+        if (ret != 0) {
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pthread_mutex_lock(&isr_lock);
+        long since_ms = (now.tv_sec - isr_read_end.tv_sec) * 1000 + (now.tv_nsec - isr_read_end.tv_nsec) / 1000000;
+        if (isr_reading == 0 && since_ms >= ISR_SETTLE_MS) {
+            isr_generation++;
+            pthread_cond_broadcast(&isr_cond);
+        }
+        pthread_mutex_unlock(&isr_lock);
+    }
+    return NULL;
+}
+
+static mraa_boolean_t
+mraa_ftdi_ft4222_isr_setup()
+{
+    pthread_mutex_lock(&isr_lock);
+    if (isr_state == 0) {
+        isr_state = -1;
+        // experimental, not yet verified against a bridge, poll unless asked
+        const char* env = getenv("MRAA_FT4222_GPIO_INT");
+        if (env == NULL || strcmp(env, "1") != 0) {
+            pthread_mutex_unlock(&isr_lock);
+            return 0;
+        }
+        pthread_mutex_init(&isr_event.eMutex, NULL);
+        pthread_cond_init(&isr_event.eCondVar, NULL);
+        // /INT stays low until the expander is read, so a level trigger
+        // cannot lose a change that happens while the pins are being read
+        if (FT4222_SetWakeUpInterrupt(ftHandle, TRUE) == FT4222_OK &&
+            FT4222_SetInterruptTrigger(ftHandle, GPIO_TRIGGER_LEVEL_LOW) == FT4222_OK &&
+            FT_SetEventNotification(ftHandle, FT_EVENT_RXCHAR, (PVOID) &isr_event) == FT_OK &&
+            pthread_create(&isr_thread, NULL, mraa_ftdi_ft4222_isr_monitor, NULL) == 0) {
+            isr_state = 1;
+        } else {
+            syslog(LOG_NOTICE, "FT4222: GPIO3 interrupt unavailable, polling the gpio expander\n");
+        }
+    }
+    pthread_mutex_unlock(&isr_lock);
+    return isr_state == 1;
+}
+
+static void
+mraa_ftdi_ft4222_isr_unlock(void* arg)
+{
+    pthread_mutex_unlock(&isr_lock);
+}
+
 static void*
 mraa_ftdi_ft4222_gpio_interrupt_handler_replace(mraa_gpio_context dev)
 {
+    struct timespec deadline;
+    unsigned int generation;
     int prev_level = mraa_ftdi_ft4222_gpio_read_replace(dev);
+
+    if (!mraa_ftdi_ft4222_isr_setup()) {
+        while (1) {
+            int level = mraa_ftdi_ft4222_gpio_read_replace(dev);
+            if (level != prev_level) {
+                dev->isr(dev->isr_args);
+                prev_level = level;
+            }
+            mraa_ftdi_ft4222_sleep_ms(100);
+        }
+        return NULL;
+    }
+
+    pthread_mutex_lock(&isr_lock);
+    generation = isr_generation;
+    pthread_mutex_unlock(&isr_lock);
     while (1) {
-        int level = mraa_ftdi_ft4222_gpio_read_replace(dev);
+        // sleep until the expander raises /INT, reading it clears /INT
+        pthread_mutex_lock(&isr_lock);
+        pthread_cleanup_push(mraa_ftdi_ft4222_isr_unlock, NULL);
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ISR_BACKSTOP_MS / 1000;
+        while (generation == isr_generation &&
+               pthread_cond_timedwait(&isr_cond, &isr_lock, &deadline) == 0)
+            ;
+        generation = isr_generation;
+        pthread_cleanup_pop(1);
+
+        int level = mraa_ftdi_ft4222_isr_read(dev);
         if (level != prev_level) {
             dev->isr(dev->isr_args);
             prev_level = level;
         }
-        // printf("mraa_ftdi_ft4222_gpio_interrupt_handler_replace\n");
-        mraa_ftdi_ft4222_sleep_ms(100);
     }
     return NULL;
 }
@@ -471,6 +665,7 @@ mraa_ftdi_ft4222_populate_i2c_func_table(mraa_adv_func_t* func_table)
     func_table->i2c_write_byte_replace = &mraa_ftdi_ft4222_i2c_write_byte;
     func_table->i2c_write_byte_data_replace = &mraa_ftdi_ft4222_i2c_write_byte_data;
     func_table->i2c_write_word_data_replace = &mraa_ftdi_ft4222_i2c_write_word_data;
+    func_table->i2c_transfer_replace = &mraa_ftdi_ft4222_i2c_transfer;
     func_table->i2c_stop_replace = &mraa_ftdi_ft4222_i2c_stop;
 }
 
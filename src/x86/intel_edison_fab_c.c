@@ -31,6 +31,7 @@
 
 #include "common.h"
 #include "x86/intel_edison_fab_c.h"
+#include "mmap/mmap_region.h"
 
 #define PLATFORM_NAME "Intel Edison"
 #define SYSFS_CLASS_GPIO "/sys/class/gpio"
@@ -69,10 +70,7 @@ static unsigned int pullup_map[] = { 216, 217, 218, 219, 220, 221, 222, 223, 224
 static int miniboard = 0;
 
 // MMAP
-static uint8_t* mmap_reg = NULL;
-static int mmap_fd = 0;
-static int mmap_size;
-static unsigned int mmap_count = 0;
+static mraa_mmap_region_t gpio_region = MRAA_MMAP_REGION(MMAP_PATH, 0, 0);
 
 mraa_result_t
 mraa_intel_edison_spi_lsbmode_replace(mraa_spi_context dev, mraa_boolean_t lsb)
@@ -595,21 +593,6 @@ mraa_intel_edison_uart_init_post(mraa_uart_context uart)
     return mraa_gpio_write(tristate, 1);
 }
 
-static mraa_result_t
-mraa_intel_edsion_mmap_unsetup()
-{
-    if (mmap_reg == NULL) {
-        syslog(LOG_ERR, "edison mmap: null register cant unsetup");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    munmap(mmap_reg, mmap_size);
-    mmap_reg = NULL;
-    if (close(mmap_fd) != 0) {
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    return MRAA_SUCCESS;
-}
-
 mraa_result_t
 mraa_intel_edison_mmap_write(mraa_gpio_context dev, int value)
 {
@@ -622,7 +605,7 @@ mraa_intel_edison_mmap_write(mraa_gpio_context dev, int value)
         valoff = 0x4c;
     }
 
-    *(volatile uint32_t*) (mmap_reg + offset + valoff) = (uint32_t)(1 << (dev->pin % 32));
+    mraa_mmap_write32(&gpio_region, offset + valoff, (uint32_t)(1 << (dev->pin % 32)));
 
     return MRAA_SUCCESS;
 }
@@ -633,7 +616,7 @@ mraa_intel_edison_mmap_read(mraa_gpio_context dev)
     uint8_t offset = ((dev->pin / 32) * sizeof(uint32_t));
     uint32_t value;
 
-    value = *(volatile uint32_t*) (mmap_reg + 0x04 + offset);
+    value = mraa_mmap_read32(&gpio_region, 0x04 + offset);
     if (value & (uint32_t)(1 << (dev->pin % 32))) {
         return 1;
     }
@@ -655,11 +638,7 @@ mraa_intel_edison_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_intel_edsion_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(&gpio_region);
     }
 
     if (dev->mmap_write != NULL && dev->mmap_read != NULL) {
@@ -667,34 +646,13 @@ mraa_intel_edison_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    // Might need to make some elements of this thread safe.
-    // For example only allow one thread to enter the following block
-    // to prevent mmap'ing twice.
-    if (mmap_reg == NULL) {
-        if ((mmap_fd = open(MMAP_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "edison map: unable to open resource0 file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-
-        struct stat fd_stat;
-        if (fstat(mmap_fd, &fd_stat) != 0) {
-            syslog(LOG_ERR, "edison map: unable to access resource0 file");
-            return MRAA_ERROR_INVALID_HANDLE;
-        }
-        mmap_size = fd_stat.st_size;
-
-        mmap_reg =
-        (uint8_t*) mmap(NULL, fd_stat.st_size, PROT_READ | PROT_WRITE, MAP_FILE | MAP_SHARED, mmap_fd, 0);
-        if (mmap_reg == MAP_FAILED) {
-            syslog(LOG_ERR, "edison mmap: failed to mmap");
-            mmap_reg = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    // resource0 is mapped whole; its size comes from the sysfs file
+    if (mraa_mmap_acquire(&gpio_region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "edison mmap: failed to mmap resource0");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     dev->mmap_write = &mraa_intel_edison_mmap_write;
     dev->mmap_read = &mraa_intel_edison_mmap_read;
-    mmap_count++;
 
     return MRAA_SUCCESS;
 }
@@ -30,37 +30,23 @@
 
 #include "common.h"
 #include "x86/intel_galileo_rev_d.h"
+#include "mmap/mmap_region.h"
 
 #define UIO_PATH "/dev/uio0"
 #define PLATFORM_NAME "Intel Galileo Gen 1"
 
-static uint8_t* mmap_reg = NULL;
-static int mmap_fd = 0;
-static int mmap_size = 0x1000;
-static unsigned int mmap_count = 0;
-
-static mraa_result_t
-mraa_intel_galileo_g1_mmap_unsetup()
-{
-    if (mmap_reg == NULL) {
-        syslog(LOG_WARNING, "galileo1: Mmap null register nothing to unsetup");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    munmap(mmap_reg, mmap_size);
-    mmap_reg = NULL;
-    close(mmap_fd);
-    return MRAA_SUCCESS;
-}
+static mraa_mmap_region_t gpio_region = MRAA_MMAP_REGION(UIO_PATH, 0, 0x1000);
 
 mraa_result_t
 mraa_intel_galileo_g1_mmap_write(mraa_gpio_context dev, int value)
 {
     int bitpos = plat->pins[dev->phy_pin].mmap.bit_pos;
+    uint32_t reg = mraa_mmap_read32(&gpio_region, 0);
     if (value) {
-        *((unsigned*) mmap_reg) |= (1 << bitpos);
+        mraa_mmap_write32(&gpio_region, 0, reg | (1 << bitpos));
         return MRAA_SUCCESS;
     }
-    *((unsigned*) mmap_reg) &= ~(1 << bitpos);
+    mraa_mmap_write32(&gpio_region, 0, reg & ~(1 << bitpos));
 
     return MRAA_SUCCESS;
 }
@@ -83,33 +69,20 @@ mraa_intel_galileo_g1_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
             return MRAA_ERROR_INVALID_PARAMETER;
         }
         dev->mmap_write = NULL;
-        mmap_count--;
-        if (mmap_count == 0) {
-            return mraa_intel_galileo_g1_mmap_unsetup();
-        }
-        return MRAA_SUCCESS;
+        return mraa_mmap_release(&gpio_region);
     }
 
     if (dev->mmap_write != NULL) {
         syslog(LOG_ERR, "galileo1: Can't enable enabled mmap gpio");
         return MRAA_ERROR_INVALID_PARAMETER;
     }
-    if (mmap_reg == NULL) {
-        if ((mmap_fd = open(UIO_PATH, O_RDWR)) < 0) {
-            syslog(LOG_ERR, "galileo1: Unable to open UIO device");
-            return MRAA_ERROR_INVALID_RESOURCE;
-        }
-        mmap_reg = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED, mmap_fd, 0);
-
-        if (mmap_reg == MAP_FAILED) {
-            syslog(LOG_ERR, "galileo1: Mmap failed to mmap");
-            mmap_reg = NULL;
-            close(mmap_fd);
-            return MRAA_ERROR_NO_RESOURCES;
-        }
+    if (mraa_mmap_acquire(&gpio_region) != MRAA_SUCCESS) {
+        syslog(LOG_ERR, "galileo1: Mmap failed to mmap");
+        return MRAA_ERROR_NO_RESOURCES;
     }
     if (mraa_setup_mux_mapped(plat->pins[dev->phy_pin].mmap.gpio) != MRAA_SUCCESS) {
         syslog(LOG_ERR, "galileo1: Unable to setup required multiplexers for mmap");
+        mraa_mmap_release(&gpio_region);
         return MRAA_ERROR_INVALID_RESOURCE;
     }
     dev->mmap_write = &mraa_intel_galileo_g1_mmap_write;
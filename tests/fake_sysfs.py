@@ -0,0 +1,207 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2016 Intel Corporation.
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+# OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+# Populates a directory tree that libmraa uses in place of sysfs and devfs
+# when MRAA_FAKE_ROOT points at it, see src/fake/fake_board.c. gpio and pwm
+# export/unexport are emulated by a watcher thread and uarts are backed by
+# ptys. Run a command against it with:
+#
+#   fake_sysfs.py [--root DIR] -- python gpio_checks.py
+
+from __future__ import print_function
+
+import argparse
+import os
+import pty
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+GPIO_ATTRS = {"direction": "in", "value": "0", "edge": "none", "active_low": "0"}
+PWM_ATTRS = {"period": "0", "duty_cycle": "0", "enable": "0"}
+
+class FakeSysfs(object):
+
+  def __init__(self, root, gpios=10, pwms=2, adc_channels=2, i2c=None, spi=None,
+               uarts=1, exported=True):
+    """i2c and spi map bus numbers (or "bus.cs" for spi) to real device
+    nodes, such as an i2c-stub adapter; without one a plain file is used.
+    The kernel creates gpioN synchronously on export while the watcher
+    lags by a poll interval, so pins are exported up front unless exported
+    is False."""
+    self.root = root
+    self.gpios = gpios
+    self.pwms = pwms
+    self.adc_channels = adc_channels
+    self.i2c = i2c if i2c is not None else {0: None}
+    self.spi = spi if spi is not None else {"0.0": None}
+    self.uarts = uarts
+    self.exported = exported
+    self.ptys = []
+    self._stop = threading.Event()
+    self._watcher = None
+
+  def path(self, *parts):
+    return os.path.join(self.root, *[p.lstrip("/") for p in parts])
+
+  def _write(self, path, value):
+    with open(path, "w") as f:
+      f.write(value + "\n")
+
+  def _mkdir(self, path):
+    if not os.path.isdir(path):
+      os.makedirs(path)
+
+  def gpio_dir(self, gpio):
+    return self.path("/sys/class/gpio", "gpio%d" % gpio)
+
+  def pwm_dir(self, chip, pwm):
+    return self.path("/sys/class/pwm", "pwmchip%d" % chip, "pwm%d" % pwm)
+
+  def export_gpio(self, gpio):
+    d = self.gpio_dir(gpio)
+    if os.path.isdir(d):
+      return
+    self._mkdir(d)
+    for attr, value in GPIO_ATTRS.items():
+      self._write(os.path.join(d, attr), value)
+
+  def export_pwm(self, chip, pwm):
+    d = self.pwm_dir(chip, pwm)
+    if os.path.isdir(d):
+      return
+    self._mkdir(d)
+    for attr, value in PWM_ATTRS.items():
+      self._write(os.path.join(d, attr), value)
+
+  def create(self):
+    gpio = self.path("/sys/class/gpio")
+    self._mkdir(gpio)
+    for f in ("export", "unexport"):
+      open(os.path.join(gpio, f), "w").close()
+    if self.exported:
+      for n in range(self.gpios):
+        self.export_gpio(n)
+
+    chip = self.path("/sys/class/pwm/pwmchip0")
+    self._mkdir(chip)
+    for f in ("export", "unexport"):
+      open(os.path.join(chip, f), "w").close()
+    self._write(os.path.join(chip, "npwm"), str(self.pwms))
+    if self.exported:
+      for n in range(self.pwms):
+        self.export_pwm(0, n)
+
+    iio = self.path("/sys/bus/iio/devices/iio:device0")
+    self._mkdir(iio)
+    for n in range(self.adc_channels):
+      self._write(os.path.join(iio, "in_voltage%d_raw" % n), "0")
+
+    dev = self.path("/dev")
+    self._mkdir(dev)
+    for name, nodes in (("i2c-%s", self.i2c), ("spidev%s", self.spi)):
+      for bus, node in nodes.items():
+        target = os.path.join(dev, name % bus)
+        if node is not None:
+          os.symlink(node, target)
+        else:
+          open(target, "w").close()
+
+    for n in range(self.uarts):
+      master, slave = pty.openpty()
+      self.ptys.append((master, slave))
+      os.symlink(os.ttyname(slave), os.path.join(dev, "ttyFAKE%d" % n))
+
+  def _drain(self, path):
+    """Read and empty a write only control file, returning the numbers written"""
+    with open(path, "r+") as f:
+      content = f.read()
+      if not content.strip():
+        return []
+      f.seek(0)
+      f.truncate()
+    return [int(v) for v in content.split() if v.isdigit()]
+
+  def _watch(self):
+    gpio = self.path("/sys/class/gpio")
+    chip = self.path("/sys/class/pwm/pwmchip0")
+    while not self._stop.is_set():
+      for n in self._drain(os.path.join(gpio, "export")):
+        self.export_gpio(n)
+      for n in self._drain(os.path.join(gpio, "unexport")):
+        shutil.rmtree(self.gpio_dir(n), ignore_errors=True)
+      for n in self._drain(os.path.join(chip, "export")):
+        self.export_pwm(0, n)
+      for n in self._drain(os.path.join(chip, "unexport")):
+        shutil.rmtree(self.pwm_dir(0, n), ignore_errors=True)
+      time.sleep(0.001)
+
+  def start(self):
+    self.create()
+    self._watcher = threading.Thread(target=self._watch)
+    self._watcher.daemon = True
+    self._watcher.start()
+    return self
+
+  def stop(self):
+    self._stop.set()
+    if self._watcher is not None:
+      self._watcher.join()
+    for master, slave in self.ptys:
+      os.close(master)
+      os.close(slave)
+    self.ptys = []
+
+  def set_input(self, gpio, value):
+    """Drive a gpio as seen by libmraa reading the value file"""
+    self._write(os.path.join(self.gpio_dir(gpio), "value"), str(int(value)))
+
+  def set_adc(self, channel, raw):
+    self._write(self.path("/sys/bus/iio/devices/iio:device0", "in_voltage%d_raw" % channel), str(raw))
+
+  def uart(self, n=0):
+    """Master side of the pty standing in for uart n"""
+    return self.ptys[n][0]
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description="Run a command against a fake sysfs tree")
+  parser.add_argument("--root", help="directory to populate, a temporary one by default")
+  parser.add_argument("command", nargs=argparse.REMAINDER)
+  args = parser.parse_args()
+  command = args.command[1:] if args.command[:1] == ["--"] else args.command
+  if not command:
+    parser.error("no command given")
+
+  root = args.root or tempfile.mkdtemp(prefix="mraa-")
+  fake = FakeSysfs(root).start()
+  env = dict(os.environ, MRAA_FAKE_ROOT=root)
+  try:
+    ret = subprocess.call(command, env=env)
+  finally:
+    fake.stop()
+    if args.root is None:
+      shutil.rmtree(root, ignore_errors=True)
+  sys.exit(ret)
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Times gpio toggles through the emulated mmap registers of a SoC against
+ * the sysfs value file, usage: mmap_soc_bench am335x|bcm2835|mt7628 [count]
+ * The registers are checked after the run so a broken fast path can't pass
+ * as a fast one.
+ */
+
+#include "mmap_soc_fixture.h"
+
+#include <time.h>
+
+#include "mraa/gpio.h"
+
+static double
+elapsed_ns(const struct timespec* start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static double
+toggle(mraa_gpio_context dev, int count)
+{
+    struct timespec start;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++) {
+        mraa_gpio_write(dev, i & 1);
+    }
+    return elapsed_ns(&start) / count;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s am335x|bcm2835|mt7628 [count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const fixture_soc_t* soc = fixture_enter(argv, argv[1]);
+    int count = argc == 3 ? atoi(argv[2]) : 1000000;
+    int gpio = soc->pins[0];
+    uint32_t bit = (uint32_t) 1 << (gpio % 32);
+
+    if (count < 2) {
+        fprintf(stderr, "count must be at least 2\n");
+        return EXIT_FAILURE;
+    }
+
+    mraa_gpio_context dev = mraa_gpio_init_raw(gpio);
+    if (dev == NULL) {
+        fprintf(stderr, "gpio%d: init failed\n", gpio);
+        return EXIT_FAILURE;
+    }
+
+    double mmap_ns = toggle(dev, count);
+    int level = (count - 1) & 1;
+    uint32_t data = fixture_read(soc, soc->data, gpio);
+    if (data != (level ? (FIXTURE_PATTERN | bit) : (FIXTURE_PATTERN & ~bit)) || mraa_gpio_read(dev) != level) {
+        fprintf(stderr, "gpio%d: DATA 0x%08x after %d mmap writes\n", gpio, data, count);
+        mraa_gpio_close(dev);
+        return EXIT_FAILURE;
+    }
+
+    if (mraa_gpio_use_mmaped(dev, 0) != MRAA_SUCCESS) {
+        fprintf(stderr, "gpio%d: unable to leave the mmap path\n", gpio);
+        mraa_gpio_close(dev);
+        return EXIT_FAILURE;
+    }
+    double sysfs_ns = toggle(dev, count);
+    mraa_gpio_close(dev);
+
+    printf("%s gpio%d, %d writes: mmap %.1f ns, sysfs %.1f ns, %.0fx\n", soc->name, gpio, count,
+           mmap_ns, sysfs_ns, sysfs_ns / mmap_ns);
+    return EXIT_SUCCESS;
+}
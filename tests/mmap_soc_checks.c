@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that mraa_gpio_write and mraa_gpio_read go through the SET, CLEAR
+ * and DATA registers of a SoC and that bank sampling reads INPUT, usage: mmap_soc_checks am335x|bcm2835|mt7628
+ * The offsets come from the reference manuals rather than libmraa so a wrong
+ * layout there shows up as a failure.
+ */
+
+#include "mmap_soc_fixture.h"
+
+#include "mraa/gpio.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                                                           \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                   \
+            fprintf(stderr, __VA_ARGS__);                                                          \
+            fprintf(stderr, "\n");                                                                 \
+            failures++;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+/* DATA of every bank other than gpio's still holds the initial pattern */
+static void
+check_other_banks(const fixture_soc_t* soc, int gpio)
+{
+    unsigned int bank;
+
+    for (bank = 0; bank < soc->banks * soc->blocks; bank++) {
+        if (bank != (unsigned int) gpio / 32) {
+            uint32_t data = fixture_read(soc, soc->data, bank * 32);
+            CHECK(data == FIXTURE_PATTERN, "gpio%d: bank %u DATA 0x%08x touched", gpio, bank, data);
+        }
+    }
+}
+
+static void
+check_pin(const fixture_soc_t* soc, int gpio)
+{
+    uint32_t bit = (uint32_t) 1 << (gpio % 32);
+    uint32_t data;
+
+    mraa_gpio_context dev = mraa_gpio_init_raw(gpio);
+    CHECK(dev != NULL, "gpio%d: init failed", gpio);
+    if (dev == NULL) {
+        return;
+    }
+
+    CHECK(mraa_gpio_write(dev, 1) == MRAA_SUCCESS, "gpio%d: write 1 failed", gpio);
+    data = fixture_read(soc, soc->data, gpio);
+    CHECK(data == (FIXTURE_PATTERN | bit), "gpio%d: DATA 0x%08x after write 1", gpio, data);
+    data = fixture_read(soc, soc->input, gpio);
+    CHECK(data == (FIXTURE_PATTERN | bit), "gpio%d: INPUT 0x%08x after write 1", gpio, data);
+    data = fixture_read(soc, soc->set, gpio);
+    CHECK(data == bit, "gpio%d: SET 0x%08x after write 1", gpio, data);
+    CHECK(mraa_gpio_read(dev) == 1, "gpio%d: read back 0 after write 1", gpio);
+
+    CHECK(mraa_gpio_write(dev, 0) == MRAA_SUCCESS, "gpio%d: write 0 failed", gpio);
+    data = fixture_read(soc, soc->data, gpio);
+    CHECK(data == (FIXTURE_PATTERN & ~bit), "gpio%d: DATA 0x%08x after write 0", gpio, data);
+    data = fixture_read(soc, soc->clear, gpio);
+    CHECK(data == bit, "gpio%d: CLEAR 0x%08x after write 0", gpio, data);
+    CHECK(mraa_gpio_read(dev) == 0, "gpio%d: read back 1 after write 0", gpio);
+
+    check_other_banks(soc, gpio);
+
+    // leave the bank as it was for the next pin
+    if (FIXTURE_PATTERN & bit) {
+        mraa_gpio_write(dev, 1);
+    }
+    mraa_gpio_close(dev);
+}
+
+static void
+check_group(const fixture_soc_t* soc)
+{
+    const int pins[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint32_t value = 0;
+
+    mraa_gpio_group_context group = mraa_gpio_group_init(pins, 8);
+    CHECK(group != NULL, "group: init failed");
+    if (group == NULL) {
+        return;
+    }
+
+    CHECK(mraa_gpio_group_write(group, 0x3c) == MRAA_SUCCESS, "group: write failed");
+    uint32_t data = fixture_read(soc, soc->data, 0);
+    CHECK(data == ((FIXTURE_PATTERN & ~0xffu) | 0x3c), "group: DATA 0x%08x after writing 0x3c", data);
+    // one store per register for the whole bank
+    data = fixture_read(soc, soc->set, 0);
+    CHECK(data == 0x3c, "group: SET 0x%08x after writing 0x3c", data);
+    data = fixture_read(soc, soc->clear, 0);
+    CHECK(data == 0xc3, "group: CLEAR 0x%08x after writing 0x3c", data);
+    CHECK(mraa_gpio_group_read(group, &value) == MRAA_SUCCESS && value == 0x3c, "group: read 0x%02x", value);
+
+    mraa_gpio_group_write(group, FIXTURE_PATTERN & 0xff);
+    mraa_gpio_group_close(group);
+}
+
+/* sampling maps the bank itself, like on a board without per-pin mmap */
+static void
+check_sample(const fixture_soc_t* soc)
+{
+    int gpio = soc->pins[0];
+    uint32_t samples[8];
+    unsigned long long timestamps[3];
+    int i;
+
+    mraa_gpio_context dev = mraa_gpio_init_raw(gpio);
+    CHECK(dev != NULL, "sample: gpio%d init failed", gpio);
+    if (dev == NULL) {
+        return;
+    }
+    mraa_gpio_write(dev, 1);
+    CHECK(mraa_gpio_use_mmaped(dev, 0) == MRAA_SUCCESS, "sample: gpio%d left mmap on", gpio);
+
+    uint32_t input = fixture_read(soc, soc->input, gpio);
+    CHECK(mraa_gpio_sample_bank(dev, samples, 8, 4, timestamps) == MRAA_SUCCESS, "sample: gpio%d failed", gpio);
+    for (i = 0; i < 8; i++) {
+        CHECK(samples[i] == input, "sample: %d is 0x%08x, INPUT 0x%08x", i, samples[i], input);
+    }
+    CHECK(timestamps[0] <= timestamps[1] && timestamps[1] <= timestamps[2], "sample: timestamps go backwards");
+
+    mraa_gpio_close(dev);
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s am335x|bcm2835|mt7628\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const fixture_soc_t* soc = fixture_enter(argv, argv[1]);
+    int i;
+
+    for (i = 0; i < fixture_npins(soc); i++) {
+        check_pin(soc, soc->pins[i]);
+    }
+    check_group(soc);
+    check_sample(soc);
+
+    if (failures != 0) {
+        fprintf(stderr, "%s: %d checks failed\n", soc->name, failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: SET/CLEAR/DATA registers behave\n", soc->name);
+    return EXIT_SUCCESS;
+}
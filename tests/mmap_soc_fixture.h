@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Runs a test against the fake platform emulating the gpio registers of a
+ * SoC. libmraa picks its platform in a constructor, so the first run builds
+ * a sysfs tree and register files under /tmp and re-executes itself with
+ * MRAA_FAKE_ROOT, MRAA_FAKE_SOC and MRAA_MMAP_SIM pointing at them. The tree
+ * is removed when the second run exits.
+ */
+
+#pragma once
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define FIXTURE_PATTERN 0xa5a5a5a5
+
+/* Register layouts as given in the SoC reference manuals */
+typedef struct {
+    const char* name;
+    uint32_t set;
+    uint32_t clear;
+    uint32_t data;
+    uint32_t input;
+    unsigned int banks; /* 32 bit registers per block */
+    unsigned int blocks;
+    unsigned long base[4];
+    size_t size;
+    int pins[4]; /* one gpio in each bank or block, -1 terminated */
+} fixture_soc_t;
+
+static const fixture_soc_t fixture_socs[] = {
+    { "am335x", 0x194, 0x190, 0x13c, 0x138, 1, 4,
+      { 0x44e07000, 0x4804c000, 0x481ac000, 0x481ae000 }, 4096, { 5, 44, 66, 117 } },
+    { "bcm2835", 0x01c, 0x028, 0x034, 0x034, 2, 1, { 0x20200000 }, 4096, { 17, 45, -1 } },
+    { "mt7628", 0x630, 0x640, 0x620, 0x620, 3, 1, { 0x10000000 }, 4096, { 11, 38, 72, -1 } },
+};
+
+static char fixture_root[PATH_MAX];
+
+static const fixture_soc_t*
+fixture_soc(const char* name)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(fixture_socs) / sizeof(fixture_socs[0]); i++) {
+        if (strcmp(fixture_socs[i].name, name) == 0) {
+            return &fixture_socs[i];
+        }
+    }
+    return NULL;
+}
+
+static int
+fixture_npins(const fixture_soc_t* soc)
+{
+    int n = 0;
+    while (n < 4 && soc->pins[n] >= 0) {
+        n++;
+    }
+    return n;
+}
+
+/* Register file libmraa creates for the block holding gpio */
+static void
+fixture_regs(const fixture_soc_t* soc, int gpio, char* path, size_t len)
+{
+    unsigned int block = gpio / 32 / soc->banks;
+    snprintf(path, len, "%s/regs/_dev_mem@%lx", getenv("MRAA_FIXTURE_ROOT"), soc->base[block]);
+}
+
+/* Byte offset of the register of gpio's bank in a layout, reg being the first */
+static uint32_t
+fixture_reg(const fixture_soc_t* soc, uint32_t reg, int gpio)
+{
+    return reg + (gpio / 32 % soc->banks) * 4;
+}
+
+static uint32_t
+fixture_read(const fixture_soc_t* soc, uint32_t reg, int gpio)
+{
+    char path[PATH_MAX];
+    uint32_t value = 0xdeadbeef;
+
+    fixture_regs(soc, gpio, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || pread(fd, &value, sizeof(value), fixture_reg(soc, reg, gpio)) != sizeof(value)) {
+        fprintf(stderr, "unable to read %s\n", path);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return value;
+}
+
+static int
+fixture_mkfile(const char* path, const void* data, size_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    int ret = write(fd, data, len) == (ssize_t) len ? 0 : -1;
+    close(fd);
+    return ret;
+}
+
+static int
+fixture_gpio(int gpio)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/sys/class/gpio/gpio%d", fixture_root, gpio);
+    if (mkdir(path, 0755) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/sys/class/gpio/gpio%d/direction", fixture_root, gpio);
+    if (fixture_mkfile(path, "out\n", 4) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/sys/class/gpio/gpio%d/value", fixture_root, gpio);
+    return fixture_mkfile(path, "0\n", 2);
+}
+
+static int
+fixture_unlink(const char* path, const struct stat* st, int flag, struct FTW* ftw)
+{
+    return remove(path);
+}
+
+static void
+fixture_cleanup()
+{
+    const char* root = getenv("MRAA_FIXTURE_ROOT");
+    if (root != NULL) {
+        nftw(root, fixture_unlink, 16, FTW_DEPTH | FTW_PHYS);
+    }
+}
+
+/*
+ * Returns in the re-executed process with the fake platform emulating soc.
+ * DATA and INPUT of every block start out as FIXTURE_PATTERN.
+ */
+static const fixture_soc_t*
+fixture_enter(char** argv, const char* name)
+{
+    const fixture_soc_t* soc = fixture_soc(name);
+    char path[PATH_MAX];
+    unsigned int i, b;
+
+    if (soc == NULL) {
+        fprintf(stderr, "unknown soc %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    if (getenv("MRAA_FIXTURE_ROOT") != NULL) {
+        atexit(fixture_cleanup);
+        return soc;
+    }
+
+    snprintf(fixture_root, sizeof(fixture_root), "/tmp/mraa-%s-XXXXXX", soc->name);
+    if (mkdtemp(fixture_root) == NULL) {
+        perror("mkdtemp");
+        exit(EXIT_FAILURE);
+    }
+    const char* dirs[] = { "/sys", "/sys/class", "/sys/class/gpio", "/regs" };
+    for (i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", fixture_root, dirs[i]);
+        mkdir(path, 0755);
+    }
+    // board pins 0-7 of the fake platform are gpio 0-7
+    for (i = 0; i < 8; i++) {
+        fixture_gpio(i);
+    }
+    for (i = 0; i < 4 && soc->pins[i] >= 0; i++) {
+        if (soc->pins[i] >= 8) {
+            fixture_gpio(soc->pins[i]);
+        }
+    }
+
+    uint32_t* block = calloc(1, soc->size);
+    for (b = 0; b < soc->banks; b++) {
+        block[soc->data / 4 + b] = FIXTURE_PATTERN;
+        block[soc->input / 4 + b] = FIXTURE_PATTERN;
+    }
+    for (b = 0; b < soc->blocks; b++) {
+        snprintf(path, sizeof(path), "%s/regs/_dev_mem@%lx", fixture_root, soc->base[b]);
+        if (fixture_mkfile(path, block, soc->size) != 0) {
+            fprintf(stderr, "unable to create %s\n", path);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(block);
+
+    snprintf(path, sizeof(path), "%s/regs", fixture_root);
+    setenv("MRAA_FIXTURE_ROOT", fixture_root, 1);
+    setenv("MRAA_FAKE_ROOT", fixture_root, 1);
+    setenv("MRAA_FAKE_SOC", soc->name, 1);
+    setenv("MRAA_MMAP_SIM", path, 1);
+    execv("/proc/self/exe", argv);
+    perror("execv");
+    fixture_cleanup();
+    exit(EXIT_FAILURE);
+}